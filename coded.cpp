@@ -0,0 +1,39 @@
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "metrics.hpp"
+#include "service.hpp"
+
+// the server stop() is called from the signal handler
+static service::ServiceServer *running = nullptr;
+
+int main(int argc, char** argv) {
+
+	// coded SOCKET CODE... preloads the codes and serves them until SIGINT or SIGTERM
+	MetricsOptions metricsOptions;
+	int threads = 0;
+	std::vector<std::string> args;
+	for(int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if(arg.starts_with("--threads=")) threads = std::stoi(arg.substr(10));
+		else if(!metricsOptions.parse(arg)) args.push_back(arg);
+	}
+	if(args.size() < 2) {
+		std::cerr << "usage: coded [--threads=N] [--metrics=TARGET] SOCKET CODE..." << std::endl;
+		exit(1);
+	}
+
+	service::CodeService codes;
+	for(std::size_t i = 1; i < args.size(); ++i) {
+		codes.load(args[i]);
+	}
+	MetricsReporter reporter(Metrics::global(), metricsOptions);
+
+	service::ServiceServer server(codes, args[0], threads);
+	running = &server;
+	std::signal(SIGINT, [](int) { running->stop(); });
+	std::signal(SIGTERM, [](int) { running->stop(); });
+	std::cerr << std::format("serving {} codes on {}", codes.size(), args[0]) << std::endl;
+	server.run();
+}
@@ -1,32 +1,108 @@
 #include <iostream>
 #include <memory>
 #include "code.hpp"
+#include "cyclic.hpp"
 #include "decoder.hpp"
+#include "hamming.hpp"
+#include "isd.hpp"
+#include "metrics.hpp"
+#include "service.hpp"
 #include <fstream>
+#include <string>
+#include <vector>
 
 int main(int argc, char** argv) {
 
+	// --isd decodes with information sets instead of a syndrome table, for codes too large for one
+	// --connect=SOCKET hands the blocks to a running coded that has the code file loaded
+	// --shared keeps the syndrome table in shared memory for every decode of the same code, it stays
+	// there after the last decode exits until --unshare removes it
+	bool useIsd = false;
+	bool shared = false;
+	bool unshare = false;
+	std::string connect;
+	MetricsOptions metricsOptions;
+	std::vector<char*> files;
+	for(int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if(arg == "--isd") useIsd = true;
+		else if(arg == "--shared") shared = true;
+		else if(arg == "--unshare") unshare = true;
+		else if(arg.starts_with("--connect=")) connect = arg.substr(10);
+		else if(!metricsOptions.parse(arg)) files.push_back(argv[i]);
+	}
+
+	if(!connect.empty()) {
+		if(files.size() != 1) {
+			std::cerr << "--connect needs the code file" << std::endl;
+			exit(1);
+		}
+		std::ios::sync_with_stdio(false);
+		service::ServiceClient client(connect);
+		client.stream(service::Decode, client.info(files[0]), std::cin, [](auto &received, bool ok, auto &decoded) {
+			std::cerr << "received: " << std::endl;
+			for(int x : received) std::cerr << x;
+			std::cerr << std::endl;
+			if(!ok) {
+				std::cerr << "error" << std::endl;
+				return;
+			}
+			std::cerr << "decoded: " << std::endl;
+			for(int x : decoded) std::cerr << x;
+			std::cerr << std::endl;
+		});
+		return 0;
+	}
 
 	std::unique_ptr<LinearCode> code;
-	if(argc == 1) {
+	if(files.size() == 0) {
 		code = std::make_unique<LinearCode>(std::cin);
 	}
-	else if(argc == 2) {
-		std::ifstream in(argv[1]);
+	else if(files.size() == 1) {
+		std::ifstream in(files[0]);
 		code = std::make_unique<LinearCode>(in);
 	}
 	else {
 		std::cerr << "only one argument needed" << std::endl;
 		exit(1);
 	}
+	if(unshare) {
+		std::string name = SindromeDecoder::sharedNameFor(*code);
+		std::cerr << (SharedSegment::remove(name) ? "removed " : "no shared table ") << name << std::endl;
+		return 0;
+	}
 	code->generator.print(std::cerr);
+	Metrics &metrics = code->metrics();
+	MetricsReporter reporter(metrics, metricsOptions);
+
+	// Hamming codes decode from the syndrome alone, cyclic codes only need the Meggitt table,
+	// every other code gets the full syndrome table
+	std::optional<HammingCode> hamming;
+	std::optional<CyclicCode> cyclic;
+	std::unique_ptr<IsdDecoder> isd;
+	std::unique_ptr<SindromeDecoder> decoder;
+	if(!useIsd) hamming = HammingCode::fromLinearCode(*code);
+	if(!useIsd && !hamming) cyclic = CyclicCode::fromLinearCode(*code);
 
-	SindromeDecoder decoder(*code);
+	if(useIsd) {
+		isd = std::make_unique<IsdDecoder>(*code);
+	}
+	else if(hamming) {
+		std::cerr << std::format("{}Hamming code, {} check bits", hamming->isExtended() ? "extended " : "", hamming->redundancy()) << std::endl;
+	}
+	else if(cyclic) {
+		std::cerr << std::format("cyclic code, g(x) = {:#x}, {} stored syndromes", cyclic->generatorPolynomial(), cyclic->tableSize()) << std::endl;
+	}
+	else {
+		// words read while the table fills are decoded by searching the missing weights
+		decoder = std::make_unique<SindromeDecoder>(*code, -1, WarmUp::Background, shared ? TableStorage::Shared : TableStorage::Private);
+	}
 	
 	int cnt = 0;
 	auto arr = Zeros((_, code->length()), type<int>);
 	char c = '\0';
 	while((std::cin.get(c))) {
+		metrics.add(Metrics::BytesIn);
 		if(c == '0' || c == '1') {
 			arr[cnt] = c - '0'; 
 			++cnt;
@@ -36,12 +112,33 @@ int main(int argc, char** argv) {
 				for(int x : arr) std::cerr << x;
 
 				std::cerr << std::endl;
-				auto res = decoder.decode(arr);
+				NDArray<int, int> res = NDArray((_, 0), type<int>);
+				if(isd) {
+					res ^= isd->decode(arr);
+				}
+				else if(hamming) {
+					if(hamming->correct(arr)) {
+						if(hamming->isSystematic()) res ^= hamming->message(arr);
+						else res ^= solve(code->generator, arr);
+					}
+				}
+				else if(!cyclic) {
+					res ^= decoder->decode(arr);
+				}
+				else if(cyclic->correct(arr)) {
+					res ^= solve(code->generator, arr);
+				}
+				// the syndrome table decoder keeps its own block counts
+				if(!decoder) {
+					metrics.add(Metrics::BlocksDecoded);
+					if(res.size() == 0) metrics.add(Metrics::DecodeFailures);
+				}
 				if(res.size() == 0) {
 					std::cerr << "error" << std::endl;
 					cnt = 0;
 					continue;
 				}
+				metrics.add(Metrics::BytesOut, res.size());
 
 				std::cerr << "decoded: " << std::endl;
 				for(int x : res) {
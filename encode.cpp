@@ -1,17 +1,50 @@
 #include <iostream>
 #include <fstream>
 #include <memory>
+#include <string>
+#include <vector>
 #include "code.hpp"
+#include "metrics.hpp"
+#include "service.hpp"
+#include "view.hpp"
 
 int main(int argc, char** argv) {
 
 
+	// --connect=SOCKET hands the blocks to a running coded that has the code file loaded
+	std::string connect;
+	MetricsOptions metricsOptions;
+	std::vector<char*> files;
+	for(int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if(arg.starts_with("--connect=")) connect = arg.substr(10);
+		else if(!metricsOptions.parse(arg)) files.push_back(argv[i]);
+	}
+
+	if(!connect.empty()) {
+		if(files.size() != 1) {
+			std::cerr << "--connect needs the code file" << std::endl;
+			exit(1);
+		}
+		std::ios::sync_with_stdio(false);
+		service::ServiceClient client(connect);
+		client.stream(service::Encode, client.info(files[0]), std::cin, [](auto &, bool, auto &word) {
+			for(int x : word) std::cout << x;
+			std::cout << std::endl;
+
+			std::clog << "sent: " << std::endl;
+			for(int x : word) std::clog << x;
+			std::clog << std::endl;
+		});
+		return 0;
+	}
+
 	std::unique_ptr<LinearCode> code;
-	if(argc == 1) {
+	if(files.size() == 0) {
 		code = std::make_unique<LinearCode>(std::cin);
 	}
-	else if(argc == 2) {
-		std::ifstream in(argv[1]);
+	else if(files.size() == 1) {
+		std::ifstream in(files[0]);
 		code = std::make_unique<LinearCode>(in);
 	}
 	else {
@@ -19,22 +52,28 @@ int main(int argc, char** argv) {
 		exit(1);
 	}
 	//code->generator.print(std::clog);
+	Metrics &metrics = code->metrics();
+	MetricsReporter reporter(metrics, metricsOptions);
 	
 	int cnt = 0;
 	auto arr = Zeros((_, code->blockLength()), type<int>);
 	char c;
 	while((std::cin.get(c))) {
+		metrics.add(Metrics::BytesIn);
 		if(c == '0' || c == '1') {
 			arr[cnt] = c - '0'; 
 			++cnt;
 
 			if(cnt == code->blockLength()) {
-				auto res = code->encode(arr);
-				for(int x : res[0]) std::cout << x;
+				Arena::Scope scratch;
+				auto res = code->encode(arr, scratch.arena);
+				auto word = viewOf(res)[0];
+				for(int x : word) std::cout << x;
 				std::cout << std::endl;
+				metrics.add(Metrics::BytesOut, word.size() + 1);
 				
 				std::clog << "sent: " << std::endl;
-				for(int x : res[0]) std::clog << x;
+				for(int x : word) std::clog << x;
 				std::clog << std::endl;
 
 				cnt = 0;
@@ -0,0 +1,48 @@
+#include <iostream>
+#include <memory>
+#include "code.hpp"
+#include "equivalence.hpp"
+#include <fstream>
+#include <string>
+#include <vector>
+
+// groups the code files given as arguments into classes of permutation equivalent codes,
+// with the order of every class's automorphism group
+int main(int argc, char** argv) {
+	if(argc < 2) {
+		std::cerr << "code files needed" << std::endl;
+		exit(1);
+	}
+
+	struct Class {
+		CanonicalForm form;
+		std::vector<std::string> files;
+	};
+	std::vector<Class> classes;
+	for(int i = 1; i < argc; ++i) {
+		std::ifstream in(argv[i]);
+		if(!in) {
+			std::cerr << "cannot open " << argv[i] << std::endl;
+			continue;
+		}
+		LinearCode code(in);
+		try {
+			CanonicalForm form(code.packedGenerator());
+			auto same = std::find_if(classes.begin(), classes.end(), [&](const Class &c) {
+				return c.form.form().rows() == form.form().rows() && c.form.form().cols() == form.form().cols() &&
+					   CanonicalForm::same(c.form.form(), form.form());
+			});
+			if(same != classes.end()) same->files.push_back(argv[i]);
+			else classes.push_back({std::move(form), {argv[i]}});
+		}
+		catch(const std::exception &e) {
+			std::cerr << argv[i] << ": " << e.what() << std::endl;
+		}
+	}
+
+	for(auto &c : classes) {
+		std::cout << std::format("[{}, {}] |Aut| = {}:", c.form.form().cols(), c.form.form().rows(), c.form.groupOrder().toString());
+		for(auto &file : c.files) std::cout << " " << file;
+		std::cout << std::endl;
+	}
+}
@@ -12,6 +12,8 @@
 #include <gauss.hpp>
 #include <golay.hpp>
 #include "code.hpp"
+#include "decoder.hpp"
+#include "field.hpp"
 
 using P = std::pair<int, int>;
 
@@ -151,4 +153,25 @@ int main() {
 
 		c.encode(a).print(std::cout);
 	}
+	{
+		std::cout << "------------ Ternary Tetracode ------------------" << std::endl;
+		NDArray G((_, 2, 4), type<GF3>);
+		int		rows[2][4] = {{1, 0, 1, 1}, {0, 1, 1, 2}};
+		for (int i = 0; i < 2; ++i)
+			for (int j = 0; j < 4; ++j)
+				G[i, j] = GF3(rows[i][j]);
+		BasicLinearCode<GF3> t(G);
+		t.check.print(std::cout);
+
+		BasicSindromeDecoder<GF3> decoder(t);
+		NDArray					  m((_, 2), type<GF3>);
+		m[0] = GF3(2);
+		m[1] = GF3(1);
+		auto			  word = t.encode(m);
+		NDArray<GF3, int> received((_, 4), type<GF3>);
+		for (int j = 0; j < 4; ++j)
+			received[j] = GF3(word[0, j]);
+		received[2] = GF3(received[2]) + GF3(1);
+		decoder.decode(received).print(std::cout);
+	}
 }
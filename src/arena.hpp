@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/// bump allocator for short-lived scratch arrays. Nothing is freed one by one,
+/// an Arena::Scope hands everything allocated during its lifetime back at once,
+/// so a hot loop that opens a scope per iteration reuses the same memory
+class Arena {
+	struct Block {
+		std::unique_ptr<std::byte[]> data;
+		std::size_t					 size;
+	};
+
+	std::vector<Block> blocks;
+	std::size_t		   blockSize;
+	std::size_t		   current = 0;		// block that allocations are served from
+	std::size_t		   used	   = 0;		// bytes taken from the current block
+
+   public:
+	struct Mark {
+		std::size_t block;
+		std::size_t used;
+	};
+
+	/// restores the arena to the state it had when the scope was opened
+	class Scope {
+		Mark mark;
+
+	   public:
+		Arena &arena;
+
+		Scope(Arena &arena = Arena::local()) : mark(arena.mark()), arena(arena) {}
+		~Scope() { arena.release(mark); }
+
+		Scope(const Scope &)			= delete;
+		Scope &operator=(const Scope &) = delete;
+	};
+
+	explicit Arena(std::size_t blockSize = 1 << 16) : blockSize(blockSize) {}
+
+	Arena(const Arena &)			= delete;
+	Arena &operator=(const Arena &) = delete;
+
+	/// scratch arena of the calling thread
+	static Arena &local() {
+		thread_local Arena arena;
+		return arena;
+	}
+
+	template <class T>
+	T *allocate(std::size_t n) {
+		static_assert(std::is_trivially_destructible_v<T>, "arena memory is released without running destructors");
+		std::size_t bytes = n * sizeof(T);
+		while (true) {
+			if (current < blocks.size()) {
+				Block		&b	   = blocks[current];
+				void		*p	   = b.data.get() + used;
+				std::size_t space = b.size - used;
+				if (std::align(alignof(T), bytes, p, space)) {
+					used = b.size - space + bytes;
+					std::uninitialized_default_construct_n(static_cast<T *>(p), n);
+					return static_cast<T *>(p);
+				}
+				++current;
+				used = 0;
+				continue;
+			}
+			std::size_t size = std::max(blockSize, bytes + alignof(T));
+			blocks.push_back({std::make_unique<std::byte[]>(size), size});
+		}
+	}
+
+	Mark mark() const { return {current, used}; }
+	void release(Mark m) {
+		current = m.block;
+		used	= m.used;
+	}
+	void reset() { release({0, 0}); }
+
+	std::size_t capacity() const {
+		std::size_t res = 0;
+		for (auto &b : blocks)
+			res += b.size;
+		return res;
+	}
+};
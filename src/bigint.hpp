@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// signed integer of any size, with just the operations exact weight enumerator transforms need
+class BigInt {
+	std::vector<uint32_t> mag;	   // magnitude, least significant limb first, no leading zero limbs
+	bool				  negative = false;
+
+	void trim() {
+		while (!mag.empty() && mag.back() == 0)
+			mag.pop_back();
+		if (mag.empty()) negative = false;
+	}
+
+	static int compareMagnitude(const std::vector<uint32_t> &a, const std::vector<uint32_t> &b) {
+		if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+		for (std::size_t i = a.size(); i-- > 0;)
+			if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+		return 0;
+	}
+
+	static void addMagnitude(std::vector<uint32_t> &a, const std::vector<uint32_t> &b) {
+		if (a.size() < b.size()) a.resize(b.size(), 0);
+		uint64_t carry = 0;
+		for (std::size_t i = 0; i < a.size(); ++i) {
+			carry += uint64_t(a[i]) + (i < b.size() ? b[i] : 0);
+			a[i]  = uint32_t(carry);
+			carry >>= 32;
+		}
+		if (carry) a.push_back(uint32_t(carry));
+	}
+
+	/// a -= b for |a| >= |b|
+	static void subtractMagnitude(std::vector<uint32_t> &a, const std::vector<uint32_t> &b) {
+		int64_t borrow = 0;
+		for (std::size_t i = 0; i < a.size(); ++i) {
+			int64_t d = int64_t(a[i]) - (i < b.size() ? b[i] : 0) - borrow;
+			borrow	  = d < 0;
+			a[i]	  = uint32_t(d + (borrow << 32));
+		}
+	}
+
+   public:
+	BigInt(long long v = 0) : negative(v < 0) {
+		unsigned long long m = v < 0 ? 0ull - (unsigned long long)v : v;
+		for (; m; m >>= 32)
+			mag.push_back(uint32_t(m));
+	}
+
+	bool isZero() const { return mag.empty(); }
+	bool isNegative() const { return negative; }
+
+	BigInt operator-() const {
+		BigInt res = *this;
+		if (!res.isZero()) res.negative = !negative;
+		return res;
+	}
+
+	BigInt &operator+=(const BigInt &b) {
+		if (negative == b.negative) addMagnitude(mag, b.mag);
+		else if (compareMagnitude(mag, b.mag) >= 0) subtractMagnitude(mag, b.mag);
+		else {
+			std::vector<uint32_t> res = b.mag;
+			subtractMagnitude(res, mag);
+			mag		 = std::move(res);
+			negative = b.negative;
+		}
+		trim();
+		return *this;
+	}
+	BigInt &operator-=(const BigInt &b) { return *this += -b; }
+
+	BigInt &operator*=(const BigInt &b) {
+		std::vector<uint32_t> res(mag.size() + b.mag.size(), 0);
+		for (std::size_t i = 0; i < mag.size(); ++i) {
+			uint64_t carry = 0;
+			for (std::size_t j = 0; j < b.mag.size(); ++j) {
+				carry += uint64_t(mag[i]) * b.mag[j] + res[i + j];
+				res[i + j] = uint32_t(carry);
+				carry >>= 32;
+			}
+			res[i + b.mag.size()] = uint32_t(carry);
+		}
+		mag		 = std::move(res);
+		negative = negative != b.negative;
+		trim();
+		return *this;
+	}
+
+	/// division by a small number that is known to divide
+	BigInt &divideExact(uint32_t d) {
+		uint64_t rem = 0;
+		for (std::size_t i = mag.size(); i-- > 0;) {
+			uint64_t cur = (rem << 32) | mag[i];
+			mag[i]		 = uint32_t(cur / d);
+			rem			 = cur % d;
+		}
+		assert(rem == 0 && "inexact division");
+		trim();
+		return *this;
+	}
+
+	/// division by 2^bits that is known to divide
+	BigInt &operator>>=(int bits) {
+		int limbs = bits / 32, shift = bits % 32;
+		mag.erase(mag.begin(), mag.begin() + std::min<std::size_t>(limbs, mag.size()));
+		if (shift)
+			for (std::size_t i = 0; i < mag.size(); ++i)
+				mag[i] = (mag[i] >> shift) | (i + 1 < mag.size() ? mag[i + 1] << (32 - shift) : 0);
+		trim();
+		return *this;
+	}
+
+	friend BigInt operator+(BigInt a, const BigInt &b) { return a += b; }
+	friend BigInt operator-(BigInt a, const BigInt &b) { return a -= b; }
+	friend BigInt operator*(BigInt a, const BigInt &b) { return a *= b; }
+
+	bool operator==(const BigInt &other) const = default;
+
+	std::string toString() const {
+		if (isZero()) return "0";
+		std::string			  res;
+		std::vector<uint32_t> digits = mag;
+		while (!digits.empty()) {
+			uint64_t rem = 0;
+			for (std::size_t i = digits.size(); i-- > 0;) {
+				uint64_t cur = (rem << 32) | digits[i];
+				digits[i]	 = uint32_t(cur / 1000000000);
+				rem			 = cur % 1000000000;
+			}
+			while (!digits.empty() && digits.back() == 0)
+				digits.pop_back();
+			for (int i = 0; i < 9 && (rem || !digits.empty()); ++i, rem /= 10)
+				res.push_back(char('0' + rem % 10));
+		}
+		if (negative) res.push_back('-');
+		std::reverse(res.begin(), res.end());
+		return res;
+	}
+
+	friend std::ostream &operator<<(std::ostream &out, const BigInt &x) { return out << x.toString(); }
+};
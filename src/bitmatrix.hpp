@@ -0,0 +1,359 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "arena.hpp"
+#include "trace.hpp"
+#include <nd.hpp>
+#include <ndarray.hpp>
+#include <primitives.hpp>
+#include <view.hpp>
+
+/// GF(2) matrix with every row packed into 64-bit words, column j of a row
+/// is bit j % 64 of word j / 64. Bits past the last column are always zero
+class BitMatrix {
+	int					  r		 = 0;
+	int					  c		 = 0;
+	int					  stride = 0;
+	std::vector<uint64_t> bits;
+
+   public:
+	static constexpr int wordBits = 64;
+
+	BitMatrix() = default;
+	BitMatrix(int rows, int cols) : r(rows), c(cols), stride(wordsFor(cols)), bits(std::size_t(rows) * stride, 0) {}
+
+	static int wordsFor(int cols) { return (cols + wordBits - 1) / wordBits; }
+
+	/// packs a row of entries mod 2 into wordsFor(row.size()) words, one word per 64 entries
+	template <class T>
+	static void packRow(RowSpan<T> row, uint64_t *out) {
+		for (std::size_t w = 0; w * wordBits < row.size(); ++w) {
+			std::size_t end	 = std::min(row.size(), (w + 1) * wordBits);
+			uint64_t	word = 0;
+			for (std::size_t j = w * wordBits; j < end; ++j)
+				word |= uint64_t(int(row[j]) & 1) << (j % wordBits);
+			out[w] = word;
+		}
+	}
+	/// the bits of a packed row as entries 0 and 1
+	template <class T>
+	static void unpackRow(const uint64_t *bits, RowSpan<T> row) {
+		for (std::size_t j = 0; j < row.size(); ++j)
+			row[j] = T(bits[j / wordBits] >> (j % wordBits) & 1);
+	}
+
+	/// packs a rank-1 (one row) or rank-2 ND container, entries are taken mod 2
+	template <class M>
+	static BitMatrix fromND(M &&m) {
+		if constexpr (ndRank<M> == 1) {
+			auto [n] = m.shape();
+			BitMatrix res(1, n);
+			if constexpr (requires { viewOf(m); })
+				if (hasView(m)) {
+					packRow(viewOf(m).span(), res.row(0));
+					return res;
+				}
+			for (int j = 0; j < n; ++j)
+				if (int(m[j]) & 1) res.set(0, j);
+			return res;
+		} else {
+			auto [n, k] = m.shape();
+			BitMatrix res(n, k);
+			if constexpr (requires { viewOf(m); })
+				if (hasView(m)) {
+					auto v = viewOf(m);
+					for (int i = 0; i < n; ++i)
+						packRow(v[i], res.row(i));
+					return res;
+				}
+			for (int i = 0; i < n; ++i) {
+				auto row = m[i];
+				for (int j = 0; j < k; ++j)
+					if (int(row[j]) & 1) res.set(i, j);
+			}
+			return res;
+		}
+	}
+
+	/// unpacks into an equally shaped rank-2 ND container
+	template <class M>
+	void toND(M &&m) const {
+		if constexpr (requires { viewOf(m); })
+			if (hasView(m)) {
+				auto v = viewOf(m);
+				for (int i = 0; i < r; ++i)
+					unpackRow(row(i), v[i]);
+				return;
+			}
+		for (int i = 0; i < r; ++i) {
+			auto row = m[i];
+			for (int j = 0; j < c; ++j)
+				row[j] = int(get(i, j));
+		}
+	}
+	NDArray<int, int, int> toND() const {
+		auto res = NDArray((_, r, c), type<int>);
+		toND(res);
+		return res;
+	}
+
+	int rows() const { return r; }
+	int cols() const { return c; }
+	int words() const { return stride; }
+
+	uint64_t	   *row(int i) { return bits.data() + std::size_t(i) * stride; }
+	const uint64_t *row(int i) const { return bits.data() + std::size_t(i) * stride; }
+
+	bool get(int i, int j) const { return (row(i)[j / wordBits] >> (j % wordBits)) & 1; }
+	void set(int i, int j) { row(i)[j / wordBits] |= uint64_t(1) << (j % wordBits); }
+	void clear(int i, int j) { row(i)[j / wordBits] &= ~(uint64_t(1) << (j % wordBits)); }
+	void flip(int i, int j) { row(i)[j / wordBits] ^= uint64_t(1) << (j % wordBits); }
+	void assign(int i, int j, bool v) { v ? set(i, j) : clear(i, j); }
+
+	/// row i ^= row j of other
+	void xorRow(int i, const BitMatrix &other, int j) {
+		uint64_t	   *dst = row(i);
+		const uint64_t *src = other.row(j);
+		for (int w = 0; w < stride; ++w)
+			dst[w] ^= src[w];
+	}
+	void swapRows(int i, int j) { std::swap_ranges(row(i), row(i) + stride, row(j)); }
+
+	bool isZero() const {
+		return std::all_of(bits.begin(), bits.end(), [](uint64_t w) { return w == 0; });
+	}
+	int rowWeight(int i) const {
+		int res = 0;
+		for (int w = 0; w < stride; ++w)
+			res += std::popcount(row(i)[w]);
+		return res;
+	}
+
+	/// transposes a 64 x 64 tile in place, bit j of word i goes to bit i of word j
+	static void transpose64(uint64_t *tile) {
+		uint64_t m = 0x00000000ffffffff;
+		for (int j = 32; j; j >>= 1, m ^= m << j)
+			for (int k = 0; k < wordBits; k = (k + j + 1) & ~j) {
+				uint64_t t = ((tile[k] >> j) ^ tile[k + j]) & m;
+				tile[k] ^= t << j;
+				tile[k + j] ^= t;
+			}
+	}
+
+	/// transposed copy, one 64 x 64 tile at a time so both matrices are accessed a word at a time
+	BitMatrix transposed() const {
+		BitMatrix res(c, r);
+		uint64_t  tile[wordBits];
+		for (int i0 = 0; i0 < r; i0 += wordBits)
+			for (int w = 0; w < stride; ++w) {
+				for (int i = 0; i < wordBits; ++i)
+					tile[i] = i0 + i < r ? row(i0 + i)[w] : 0;
+				transpose64(tile);
+				for (int j = 0; j < wordBits && w * wordBits + j < c; ++j)
+					res.row(w * wordBits + j)[i0 / wordBits] = tile[j];
+			}
+		return res;
+	}
+
+	/// copy of rows [r0, r0 + rows) and columns [c0, c0 + cols), c0 must be a multiple of 64
+	BitMatrix block(int r0, int c0, int rows, int cols) const {
+		BitMatrix res(rows, cols);
+		int		  w0 = c0 / wordBits;
+		for (int i = 0; i < rows && r0 + i < r; ++i)
+			for (int w = 0; w < res.stride && w0 + w < stride; ++w)
+				res.row(i)[w] = row(r0 + i)[w0 + w];
+		res.clearPadding();
+		return res;
+	}
+	/// writes b at rows r0.. and columns c0.., c0 must be a multiple of 64, b is cropped to fit
+	void setBlock(int r0, int c0, const BitMatrix &b) {
+		int w0 = c0 / wordBits;
+		for (int i = 0; i < b.r && r0 + i < r; ++i)
+			for (int w = 0; w < b.stride && w0 + w < stride; ++w)
+				row(r0 + i)[w0 + w] = b.row(i)[w];
+		clearPadding();
+	}
+
+	void clearPadding() {
+		if (c % wordBits == 0) return;
+		uint64_t mask = (uint64_t(1) << (c % wordBits)) - 1;
+		for (int i = 0; i < r; ++i)
+			row(i)[stride - 1] &= mask;
+	}
+
+	BitMatrix &operator+=(const BitMatrix &other) {
+		if (r != other.r || c != other.c) throw std::runtime_error("BitMatrix dimensions do not match");
+		for (std::size_t i = 0; i < bits.size(); ++i)
+			bits[i] ^= other.bits[i];
+		return *this;
+	}
+	friend BitMatrix operator+(BitMatrix a, const BitMatrix &b) { return a += b; }
+
+	bool operator==(const BitMatrix &other) const = default;
+};
+
+/// c ^= a * b by XORing whole rows of b, the cheapest way when a has only a few rows
+inline void mulAddRows(const BitMatrix &a, const BitMatrix &b, BitMatrix &c) {
+	for (int i = 0; i < a.rows(); ++i)
+		for (int w = 0; w < a.words(); ++w)
+			for (uint64_t word = a.row(i)[w]; word; word &= word - 1)
+				c.xorRow(i, b, w * BitMatrix::wordBits + std::countr_zero(word));
+}
+
+/// c ^= a * b with the Method of Four Russians: for every group of 8 rows of b all
+/// 256 of their sums are tabulated in Gray code order, one XOR per table entry,
+/// and then each row of c takes one table row per byte of the matching row of a
+inline void m4rmAdd(const BitMatrix &a, const BitMatrix &b, BitMatrix &c) {
+	constexpr int K		= 8;
+	int			  words = b.words();
+
+	Arena::Scope scratch;
+	uint64_t	*table = scratch.arena.allocate<uint64_t>(std::size_t(words) << K);
+
+	for (int g = 0; g < b.rows(); g += K) {
+		int rows = std::min(K, b.rows() - g);
+		std::fill_n(table, words, 0);
+		for (int idx = 1; idx < (1 << rows); ++idx) {
+			int gray	 = idx ^ (idx >> 1);
+			int previous = (idx - 1) ^ ((idx - 1) >> 1);
+			int bit		 = std::countr_zero(unsigned(gray ^ previous));
+			const uint64_t *src = b.row(g + bit);
+			uint64_t		 *dst = table + std::size_t(gray) * words;
+			uint64_t		 *old = table + std::size_t(previous) * words;
+			for (int w = 0; w < words; ++w)
+				dst[w] = old[w] ^ src[w];
+		}
+
+		int word  = g / BitMatrix::wordBits;
+		int shift = g % BitMatrix::wordBits;
+		for (int i = 0; i < a.rows(); ++i) {
+			unsigned x = (a.row(i)[word] >> shift) & ((1u << rows) - 1);
+			if (!x) continue;
+			const uint64_t *src = table + std::size_t(x) * words;
+			uint64_t		 *dst = c.row(i);
+			for (int w = 0; w < words; ++w)
+				dst[w] ^= src[w];
+		}
+	}
+}
+
+/// products x * b with a fixed b: the sums of every group of 8 rows of b are tabulated once,
+/// in Gray code order like m4rmAdd does per call, so each row of x only costs one table row
+/// load and XOR per byte. A table takes ceil(b.rows() / 8) * 256 * b.words() words
+class ByteTable {
+	int					  r = 0, c = 0, stride = 0;
+	std::vector<uint64_t> table;
+
+   public:
+	static constexpr int K = 8;
+
+	ByteTable() = default;
+	explicit ByteTable(const BitMatrix &b)
+		: r(b.rows()), c(b.cols()), stride(b.words()), table(bytesFor(r, c) / sizeof(uint64_t), 0) {
+		for (int g = 0; g < r; g += K) {
+			int		  rows	= std::min(K, r - g);
+			uint64_t *group = table.data() + std::size_t(g / K) * (stride << K);
+			for (int idx = 1; idx < (1 << rows); ++idx) {
+				int				gray	 = idx ^ (idx >> 1);
+				int				previous = (idx - 1) ^ ((idx - 1) >> 1);
+				const uint64_t *src		 = b.row(g + std::countr_zero(unsigned(gray ^ previous)));
+				uint64_t	   *dst		 = group + std::size_t(gray) * stride;
+				uint64_t	   *old		 = group + std::size_t(previous) * stride;
+				for (int w = 0; w < stride; ++w)
+					dst[w] = old[w] ^ src[w];
+			}
+		}
+	}
+
+	/// size in bytes of the table of a rows x cols matrix
+	static std::size_t bytesFor(int rows, int cols) {
+		return std::size_t((rows + K - 1) / K) * (std::size_t(BitMatrix::wordsFor(cols)) << K) * sizeof(uint64_t);
+	}
+
+	int			rows() const { return r; }
+	int			cols() const { return c; }
+	bool		empty() const { return table.empty(); }
+	std::size_t bytes() const { return table.size() * sizeof(uint64_t); }
+
+	/// out = x * b, x has rows() bits packed like a BitMatrix row and out has room for cols() bits
+	void multiply(const uint64_t *x, uint64_t *out) const {
+		std::fill_n(out, stride, 0);
+		for (int g = 0; g < r; g += K) {
+			unsigned byte = (x[g / BitMatrix::wordBits] >> (g % BitMatrix::wordBits)) & 0xff;
+			if (!byte) continue;
+			const uint64_t *src = table.data() + (std::size_t(g / K) * 256 + byte) * stride;
+			for (int w = 0; w < stride; ++w)
+				out[w] ^= src[w];
+		}
+	}
+
+	BitMatrix operator()(const BitMatrix &x) const {
+		if (x.cols() != r) throw std::runtime_error("BitMatrix dimensions do not match");
+		BitMatrix res(x.rows(), c);
+		for (int i = 0; i < x.rows(); ++i)
+			multiply(x.row(i), res.row(i));
+		return res;
+	}
+};
+
+/// operands above this size in every dimension are split with Strassen-Winograd
+constexpr int strassenThreshold = 2048;
+
+inline BitMatrix multiply(const BitMatrix &a, const BitMatrix &b);
+
+/// one Strassen-Winograd step over GF(2), where addition and subtraction are both XOR.
+/// every dimension is padded to a multiple of 128 so the quadrants start on word boundaries
+inline BitMatrix strassenWinograd(const BitMatrix &a, const BitMatrix &b) {
+	auto half = [](int x) { return (x + 127) / 128 * 64; };
+	int	 n = half(a.rows()), m = half(a.cols()), k = half(b.cols());
+
+	BitMatrix a11 = a.block(0, 0, n, m), a12 = a.block(0, m, n, m);
+	BitMatrix a21 = a.block(n, 0, n, m), a22 = a.block(n, m, n, m);
+	BitMatrix b11 = b.block(0, 0, m, k), b12 = b.block(0, k, m, k);
+	BitMatrix b21 = b.block(m, 0, m, k), b22 = b.block(m, k, m, k);
+
+	BitMatrix s1 = a21 + a22, s2 = s1 + a11, s3 = a11 + a21, s4 = a12 + s2;
+	BitMatrix t1 = b12 + b11, t2 = b22 + t1, t3 = b22 + b12, t4 = t2 + b21;
+
+	BitMatrix p1 = multiply(a11, b11), p2 = multiply(a12, b21);
+	BitMatrix p3 = multiply(s4, b22), p4 = multiply(a22, t4);
+	BitMatrix p5 = multiply(s1, t1), p6 = multiply(s2, t2), p7 = multiply(s3, t3);
+
+	BitMatrix u2 = p1 + p6, u3 = u2 + p7, u4 = u2 + p5;
+
+	BitMatrix res(a.rows(), b.cols());
+	res.setBlock(0, 0, p1 + p2);
+	res.setBlock(0, k, u4 + p3);
+	res.setBlock(n, 0, u3 + p4);
+	res.setBlock(n, k, u3 + p5);
+	return res;
+}
+
+/// a * b over GF(2)
+inline BitMatrix multiply(const BitMatrix &a, const BitMatrix &b) {
+	TRACE_SCOPE("BitMatrix multiply");
+	if (a.cols() != b.rows()) throw std::runtime_error("BitMatrix dimensions do not match");
+	if (std::min({a.rows(), a.cols(), b.cols()}) >= strassenThreshold) return strassenWinograd(a, b);
+
+	BitMatrix res(a.rows(), b.cols());
+	if (a.rows() < 8) mulAddRows(a, b, res);
+	else m4rmAdd(a, b, res);
+	return res;
+}
+
+inline BitMatrix operator*(const BitMatrix &a, const BitMatrix &b) { return multiply(a, b); }
+
+/// product of two binary ND matrices (or a row vector and a matrix) done on packed rows,
+/// the result is already reduced mod 2 and allocated from arena when one is given
+template <class U, class V, class... Alloc>
+auto matmulGF2(U &&u, V &&v, Alloc &...arena) {
+	BitMatrix			   c   = BitMatrix::fromND(u) * BitMatrix::fromND(v);
+	NDArray<int, int, int> res = Zeros((_, c.rows(), c.cols()), type<int>, arena...);
+	c.toND(res);
+	return res;
+}
@@ -1,36 +1,114 @@
 #pragma once
 
+#include <set>
 #include <stdexcept>
+#include <unordered_set>
+#include "bitmatrix.hpp"
+#include "combinations.hpp"
 #include "error.hpp"
 #include "gauss.hpp"
 #include "golay.hpp"
+#include "metrics.hpp"
 #include "ndarray.hpp"
+#include "ple.hpp"
+#include "trace.hpp"
+#include "weights.hpp"
 
-class LinearCode {
+/// linear code over the symbols Sym, int symbols are the binary case
+template <class Sym = int>
+class BasicLinearCode {
 	mutable bool d_computed = false;
 	mutable int	 d;
 
 	mutable bool r_computed = false;
 	mutable int	 r = 0;
 
+	mutable bool				w_computed = false;
+	mutable std::vector<BigInt> w;
+
+	Metrics *metrics_sink = &Metrics::global();
+
+	// packed copies of generator and check^t for binary codes, with their byte tables when
+	// those fit in byteTableLimit. Built with the code
+	mutable bool	  packed_computed = false;
+	mutable BitMatrix packed_generator;
+	mutable BitMatrix packed_check_t;
+	mutable ByteTable encode_table;
+	mutable ByteTable sindrome_table;
+
+	void pack() {
+		if (packed_computed) return;
+		packed_generator = BitMatrix::fromND(generator);
+		packed_check_t	 = BitMatrix::fromND(check).transposed();
+		if (ByteTable::bytesFor(packed_generator.rows(), packed_generator.cols()) <= byteTableLimit)
+			encode_table = ByteTable(packed_generator);
+		if (ByteTable::bytesFor(packed_check_t.rows(), packed_check_t.cols()) <= byteTableLimit)
+			sindrome_table = ByteTable(packed_check_t);
+		systematize();
+		packed_computed = true;
+	}
+
+	// systematic form [I | P] of the generator up to the column permutation information,
+	// parity_columns; both stay empty when the generator rows are dependent
+	mutable std::vector<int> information;
+	mutable std::vector<int> parity_columns;
+	mutable BitMatrix		 parity;
+	mutable ByteTable		 parity_table;
+	mutable bool			 identity_permutation = false;
+
+	void systematize() {
+		int		k = packed_generator.rows(), n = packed_generator.cols();
+		Echelon e(packed_generator);
+		if (e.rank() < k) return;
+
+		information = e.pivotColumns();
+		for (int j = 0, i = 0; j < n; ++j) {
+			if (i < k && information[i] == j) ++i;
+			else parity_columns.push_back(j);
+		}
+		identity_permutation = k == 0 || information.back() == k - 1;
+
+		parity = BitMatrix(k, n - k);
+		for (int i = 0; i < k; ++i)
+			for (int j = 0; j < n - k; ++j)
+				if (e.reduced().get(i, parity_columns[j])) parity.set(i, j);
+		if (ByteTable::bytesFor(k, n - k) <= byteTableLimit) parity_table = ByteTable(parity);
+	}
+
+	/// dst bits [at, at + bits) |= the first bits bits of src, dst has words words
+	static void orBits(uint64_t *dst, int words, int at, const uint64_t *src, int bits) {
+		int w0 = at / BitMatrix::wordBits, shift = at % BitMatrix::wordBits;
+		for (int w = 0; w < BitMatrix::wordsFor(bits); ++w) {
+			dst[w0 + w] |= src[w] << shift;
+			if (shift && w0 + w + 1 < words) dst[w0 + w + 1] |= src[w] >> (BitMatrix::wordBits - shift);
+		}
+	}
+
    public:
-	NDArray<int, int, int> generator;
-	NDArray<int, int, int> check;
+	using Symbol = Sym;
+
+	NDArray<Sym, int, int> generator;
+	NDArray<Sym, int, int> check;
 
-	template <class T>
-		requires(T::Elem)
-	LinearCode(T &&generator) : generator(std::forward<T>(generator)), check(orthogonal(generator)) {}
+	/// tables larger than this are not built, the products then go through BitMatrix multiplication
+	static constexpr std::size_t byteTableLimit = 256 << 10;
+
+	template <NDLike T>
+	BasicLinearCode(T &&generator) : generator(std::forward<T>(generator)), check(orthogonal(this->generator)) {
+		if constexpr (isBinary<Sym>) pack();
+	}
 
-	LinearCode(std::istream &is) : generator((_, 1, 1), type<int>), check((_, 1, 1), type<int>) {
+	BasicLinearCode(std::istream &is) : generator((_, 1, 1), type<Sym>), check((_, 1, 1), type<Sym>) {
 		std::string type;
 		is >> type;
 		if (type == "generator") {
-			generator ^= NDArray((_, 1, 1), ::type<int>, is);
+			generator ^= NDArray((_, 1, 1), ::type<Sym>, is);
 			check ^= orthogonal(generator);
 		} else if (type == "check") {
-			check ^= NDArray((_, 1, 1), ::type<int>, is);
+			check ^= NDArray((_, 1, 1), ::type<Sym>, is);
 			generator ^= orthogonal(check);
 		} else throw std::runtime_error("invalid type of input for code");
+		if constexpr (isBinary<Sym>) pack();
 	}
 
 	void serializeGenerator(std::ostream &os) {
@@ -44,38 +122,208 @@ class LinearCode {
 
 	int blockLength() { return std::get<0>(generator.shape()); }
 	int length() { return std::get<1>(generator.shape()); }
+	/// n - k, the number of check symbols and the length of a syndrome
+	int redundancy() { return std::get<0>(check.shape()); }
+
+	/// the registry encoding and the decoders of this code record to, Metrics::global() by default
+	Metrics &metrics() { return *metrics_sink; }
+	void	 reportTo(Metrics &metrics) { metrics_sink = &metrics; }
+
+	/// packed GF(2) generator, only for binary codes.
+	/// like the other cached values it is not refreshed if generator is modified later
+	const BitMatrix &packedGenerator()
+		requires isBinary<Sym>
+	{
+		pack();
+		return packed_generator;
+	}
+	/// packed check^t, a row vector times it is the syndrome
+	const BitMatrix &packedSyndromeMatrix()
+		requires isBinary<Sym>
+	{
+		pack();
+		return packed_check_t;
+	}
+
+	/// packed codewords of packed messages, one per row
+	BitMatrix packedEncode(const BitMatrix &messages)
+		requires isBinary<Sym>
+	{
+		pack();
+		if (!encode_table.empty() && encode_table.rows() == messages.cols()) return encode_table(messages);
+		return messages * packed_generator;
+	}
+	/// packed syndromes of packed received words, one per row
+	BitMatrix packedSindrome(const BitMatrix &words)
+		requires isBinary<Sym>
+	{
+		pack();
+		if (!sindrome_table.empty() && sindrome_table.rows() == words.cols()) return sindrome_table(words);
+		return words * packed_check_t;
+	}
+
+	/// columns that carry the message bits in systematic encoding, message bit i goes to column
+	/// informationPositions()[i]. Empty when the generator rows are not independent
+	const std::vector<int> &informationPositions()
+		requires isBinary<Sym>
+	{
+		pack();
+		return information;
+	}
 
-	template <class Arr>
-	auto encode(Arr &&c) {
-		auto res = matmul_fancy(c, generator, type<int>);
-		res.apply(mod2);
+	/// packed codewords of packed messages in systematic form: the message is copied to the
+	/// information positions and only the n - k parity bits m * P are computed. This is a
+	/// different map from messages to codewords than encode, which multiplies by generator as given
+	BitMatrix packedEncodeSystematic(const BitMatrix &messages)
+		requires isBinary<Sym>
+	{
+		pack();
+		int k = blockLength(), n = length();
+		if (int(information.size()) != k) throw std::runtime_error("generator does not have full rank");
+		if (messages.cols() != k) throw std::runtime_error("BitMatrix dimensions do not match");
+
+		// parity bits of one row at a time straight from the table, all at once without one
+		BitMatrix			  all = parity_table.empty() ? messages * parity : BitMatrix();
+		std::vector<uint64_t> row(parity_table.empty() ? 0 : BitMatrix::wordsFor(n - k));
+		BitMatrix			  res(messages.rows(), n);
+		for (int i = 0; i < messages.rows(); ++i) {
+			const uint64_t *checks = all.rows() ? all.row(i) : row.data();
+			if (!parity_table.empty()) parity_table.multiply(messages.row(i), row.data());
+			if (identity_permutation) {
+				std::copy_n(messages.row(i), messages.words(), res.row(i));
+				orBits(res.row(i), res.words(), k, checks, n - k);
+				continue;
+			}
+			for (int w = 0; w < messages.words(); ++w)
+				for (uint64_t bits = messages.row(i)[w]; bits; bits &= bits - 1)
+					res.set(i, information[w * BitMatrix::wordBits + std::countr_zero(bits)]);
+			for (int w = 0; w < BitMatrix::wordsFor(n - k); ++w)
+				for (uint64_t bits = checks[w]; bits; bits &= bits - 1)
+					res.set(i, parity_columns[w * BitMatrix::wordBits + std::countr_zero(bits)]);
+		}
 		return res;
 	}
 
+	/// codewords of systematic encoding, see packedEncodeSystematic. The message of such a
+	/// codeword is read back from informationPositions
+	template <class Arr, class... Alloc>
+	auto encodeSystematic(Arr &&c, Alloc &...arena)
+		requires isBinary<Sym>
+	{
+		BitMatrix			   word = packedEncodeSystematic(BitMatrix::fromND(c));
+		NDArray<int, int, int> res	= Zeros((_, word.rows(), word.cols()), type<int>, arena...);
+		word.toND(res);
+		return res;
+	}
+
+	/// the codeword is allocated from arena when one is given
+	template <class Arr, class... Alloc>
+	auto encode(Arr &&c, Alloc &...arena) {
+		Metrics::Timer timer(metrics(), Metrics::Encode);
+		if constexpr (isBinary<Sym>) {
+			BitMatrix			   word = packedEncode(BitMatrix::fromND(c));
+			NDArray<int, int, int> res	= Zeros((_, word.rows(), word.cols()), type<int>, arena...);
+			word.toND(res);
+			metrics().add(Metrics::BlocksEncoded, word.rows());
+			return res;
+		} else {
+			auto res = matmul_fancy(c, generator, type<Sym>, arena...);
+			res.apply(FieldTraits<Sym>::reduce);
+			metrics().add(Metrics::BlocksEncoded, std::get<0>(res.shape()));
+			return res;
+		}
+	}
+
+	/// syndrome check * word^t of one received word, allocated from arena when one is given
+	template <class Arr, class... Alloc>
+	NDArray<Sym, int> sindrome(Arr &&word, Alloc &...arena) {
+		NDArray<Sym, int> sind = Zeros((_, redundancy()), type<Sym>, arena...);
+		if constexpr (isBinary<Sym>) {
+			BitMatrix s = packedSindrome(BitMatrix::fromND(word));
+			for (int i = 0; i < s.cols(); ++i) {
+				sind[i] = int(s.get(0, i));
+			}
+		} else {
+			Arena::Scope scratch;
+			auto		 s = matmul_fancy(check, word, type<Sym>, scratch.arena);
+			for (std::size_t i = 0; i < sind.size(); ++i) {
+				sind[i] = Sym(s[i][0]);
+			}
+		}
+		return sind;
+	}
+
+	/// A_0..A_n, the number of codewords of every weight. Whichever of the code and its dual has
+	/// the smaller dimension is enumerated, a dual distribution goes through the MacWilliams transform
+	const std::vector<BigInt> &weightDistribution()
+		requires isBinary<Sym>
+	{
+		if (w_computed) return w;
+		TRACE_SCOPE("weightDistribution");
+		int		n = length();
+		Echelon g(BitMatrix::fromND(generator));
+		Echelon h(BitMatrix::fromND(check));
+
+		if (g.rank() <= h.rank()) {
+			auto A = enumerateWeights(g.reduced().block(0, 0, g.rank(), n));
+			w.assign(A.begin(), A.end());
+		} else {
+			auto B = enumerateWeights(h.reduced().block(0, 0, h.rank(), n));
+			w	   = macWilliams(std::vector<BigInt>(B.begin(), B.end()), h.rank());
+		}
+		w_computed = true;
+		return w;
+	}
+
 	bool isSelfOrthogonal() { return ::isSelfOrthogonal(generator); }
-	int	 getDistance() {
-		 if (!d_computed) {
-			 d			= findDistance(generator);
-			 d_computed = true;
-		 }
-		 return d;
+	/// computed once; binary codes with a smaller dual read it off the MacWilliams transform
+	int getDistance() {
+		if (!d_computed) {
+			TRACE_SCOPE("getDistance");
+			if constexpr (isBinary<Sym>) {
+				if (redundancy() < blockLength()) {
+					auto &A = weightDistribution();
+					d		= length();
+					for (int j = int(A.size()) - 1; j > 0; --j)
+						if (!A[j].isZero()) d = j;
+				} else d = findDistance(generator);
+			} else d = findDistance(generator);
+			d_computed = true;
+		}
+		return d;
 	}
 
 	int getCoverageRadius() {
 		if (r_computed) return r;
-		else {
-			std::vector<NDArray<int, int>> sindromes;
+		TRACE_SCOPE("getCoverageRadius");
+		if constexpr (isBinary<Sym>) {
+			// the smallest weight by which every syndrome has shown up
+			const BitMatrix &columns = packedSyndromeMatrix();
+			int				 red	 = columns.cols();
+			uint64_t		 total	 = red < 64 ? uint64_t(1) << red : Binomials::saturated;
+			auto			 radius	 = [&](auto &seen, auto key) {
+				  r = 0;
+				  for (int w = 0; w <= length() && seen.size() < total; ++w)
+					  forEachErrorSyndrome(columns, w, [&](const ErrorPattern &, const uint64_t *s) {
+						  if (seen.insert(key(s)).second) r = w;
+					  });
+			};
+			if (columns.words() == 1) {
+				std::unordered_set<uint64_t> seen;
+				radius(seen, [](const uint64_t *s) { return s[0]; });
+			} else {
+				std::set<std::vector<uint64_t>> seen;
+				radius(seen, [&](const uint64_t *s) { return std::vector<uint64_t>(s, s + columns.words()); });
+			}
+			r_computed = true;
+			return r;
+		} else {
+			std::vector<NDArray<Sym, int>> sindromes;
 
-			auto &&e = ErrorVectors(length(), blockLength());
 			r = 0;
-			for (auto it = e.begin(); it != e.end(); ++it) {
-				NDArray<int, int, int> s = matmul_fancy(check, *it, type<int>);
-				s.apply(mod2);
-
-				NDArray<int, int> sind = NDArray((_, blockLength()), type<int>);
-				for (std::size_t i = 0; i < sind.size(); ++i) {
-					sind[i] = s[i][0];
-				}
+			forEachErrorVector<Sym>(length(), blockLength(), [&](auto &e, int weight) {
+				Arena::Scope	  scratch;
+				NDArray<Sym, int> sind = sindrome(e, scratch.arena);
 
 				bool found = false;
 				for (auto &&entry : sindromes) {
@@ -86,12 +334,15 @@ class LinearCode {
 				}
 
 				if (!found) {
-					sindromes.emplace_back(NDArray((_, blockLength()), type<int>));
+					sindromes.emplace_back(NDArray((_, redundancy()), type<Sym>));
 					sindromes.back() = sind;
-					r				 = std::max(r, it.one_cnt);
+					r				 = std::max(r, weight);
 				}
-			}
+			});
+			r_computed = true;
 			return r;
 		}
 	}
 };
+
+using LinearCode = BasicLinearCode<int>;
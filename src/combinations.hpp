@@ -0,0 +1,218 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "bitmatrix.hpp"
+
+/// binomial coefficients C(m, i) for m <= n and i <= w, saturated at the largest uint64
+class Binomials {
+	int					  w;
+	std::vector<uint64_t> table;
+
+   public:
+	static constexpr uint64_t saturated = std::numeric_limits<uint64_t>::max();
+
+	Binomials(int n, int w) : w(w), table(std::size_t(n + 1) * (w + 1), 0) {
+		for (int m = 0; m <= n; ++m) {
+			table[std::size_t(m) * (w + 1)] = 1;
+			for (int i = 1; i <= std::min(m, w); ++i) {
+				uint64_t a = (*this)(m - 1, i - 1), b = (*this)(m - 1, i);
+				table[std::size_t(m) * (w + 1) + i] = a > saturated - b ? saturated : a + b;
+			}
+		}
+	}
+
+	uint64_t operator()(int m, int i) const {
+		if (i < 0 || i > w || m < i) return 0;
+		return table[std::size_t(m) * (w + 1) + i];
+	}
+};
+
+/// the w-subsets of {0, ..., n - 1}. For n <= 64 they are bitmasks in colex order, each found
+/// from the previous one with Gosper's hack. Longer words use sorted position lists in the
+/// revolving door order of Knuth's Algorithm R, where every step removes one position and adds
+/// another. Both orders can be ranked and unranked, so every thread can take a range of ranks
+class Combinations {
+	int		  n, w;
+	Binomials binom;
+
+   public:
+	Combinations(int n, int w) : n(n), w(w), binom(n + 1, w) {
+		if (w < 0 || w > n) throw std::runtime_error("weight out of range");
+		if (count() == Binomials::saturated) throw std::runtime_error("too many combinations");
+	}
+
+	int		 size() const { return n; }
+	int		 weight() const { return w; }
+	uint64_t count() const { return binom(n, w); }
+	bool	 usesMasks() const { return n <= 64; }
+
+	/// the next mask with as many bits in colex order, mask must not be the last one
+	static uint64_t nextMask(uint64_t mask) {
+		uint64_t low = mask & -mask, high = mask + low;
+		return (((high ^ mask) >> 2) / low) | high;
+	}
+
+	uint64_t rankMask(uint64_t mask) const {
+		uint64_t rank = 0;
+		for (int i = 1; mask; mask &= mask - 1, ++i)
+			rank += binom(std::countr_zero(mask), i);
+		return rank;
+	}
+	uint64_t unrankMask(uint64_t rank) const {
+		uint64_t mask = 0;
+		for (int i = w, m = n; i > 0; --i) {
+			while (binom(m, i) > rank)
+				--m;
+			mask |= uint64_t(1) << m;
+			rank -= binom(m, i);
+		}
+		return mask;
+	}
+
+	/// C(c_w + 1, w) - C(c_{w-1} + 1, w - 1) + ... -/+ C(c_1 + 1, 1) - [w odd], for c sorted ascending
+	uint64_t rank(const std::vector<int> &c) const {
+		uint64_t rank = 0;
+		for (int i = 1; i <= int(c.size()); ++i)
+			rank = binom(c[i - 1] + 1, i) - 1 - rank;
+		return rank;
+	}
+	void unrank(uint64_t rank, std::vector<int> &c) const {
+		c.resize(w);
+		for (int i = w, m = n; i > 0; --i) {
+			// the sets with largest element m have ranks C(m, i) .. C(m + 1, i) - 1, the rest reversed
+			while (binom(m, i) > rank)
+				--m;
+			c[i - 1] = m;
+			rank	 = binom(m + 1, i) - 1 - rank;
+		}
+	}
+
+	/// one revolving door step on c, sorted ascending, false after the last set.
+	/// out is the position that was removed and in the one that was added
+	static bool nextRevolvingDoor(std::vector<int> &c, int n, int &out, int &in) {
+		int t = c.size();
+		if (t == 0) return false;
+		auto next = [&](int j) { return j < t ? c[j] : n; };
+
+		bool increase = t % 2 == 0;
+		if (!increase && c[0] + 1 < next(1)) {
+			out = c[0];
+			in	= ++c[0];
+			return true;
+		}
+		if (increase && c[0] > 0) {
+			out = c[0];
+			in	= --c[0];
+			return true;
+		}
+		for (int j = 2; j <= t; ++j, increase = !increase) {
+			if (!increase && c[j - 1] >= j) {
+				// c_j = c_{j-1} + 1 moves down to c_{j-1}, which restarts at j - 2
+				out		 = c[j - 1];
+				in		 = j - 2;
+				c[j - 1] = c[j - 2];
+				c[j - 2] = j - 2;
+				return true;
+			}
+			if (increase && c[j - 1] + 1 < next(j)) {
+				// c_{j-1} = j - 2 leaves and c_j moves up by one
+				out		 = j - 2;
+				in		 = c[j - 1] + 1;
+				c[j - 2] = c[j - 1];
+				c[j - 1] += 1;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/// f(mask, changed) for the masks with ranks [begin, end), changed has the bits that
+	/// differ from the previous mask and is all of mask for the first one
+	template <class F>
+	void forEachMask(uint64_t begin, uint64_t end, F &&f) const {
+		if (begin >= end) return;
+		uint64_t mask = unrankMask(begin);
+		f(mask, mask);
+		for (uint64_t r = begin + 1; r < end; ++r) {
+			uint64_t next = nextMask(mask);
+			f(next, next ^ mask);
+			mask = next;
+		}
+	}
+
+	/// f(c, out, in) for the sets with revolving door ranks [begin, end), out and in are -1 for the first
+	template <class F>
+	void forEachSet(uint64_t begin, uint64_t end, F &&f) const {
+		if (begin >= end) return;
+		std::vector<int> c;
+		unrank(begin, c);
+		f(c, -1, -1);
+		for (uint64_t r = begin + 1; r < end; ++r) {
+			int out, in;
+			nextRevolvingDoor(c, n, out, in);
+			f(c, out, in);
+		}
+	}
+};
+
+/// positions of one error pattern, either a bitmask or a sorted list
+struct ErrorPattern {
+	uint64_t				mask	  = 0;
+	const std::vector<int> *positions = nullptr;
+
+	template <class F>
+	void forEachPosition(F &&f) const {
+		if (positions)
+			for (int p : *positions)
+				f(p);
+		else
+			for (uint64_t m = mask; m; m &= m - 1)
+				f(std::countr_zero(m));
+	}
+};
+
+/// calls f(pattern, syndrome) for the errors of weight w with ranks [begin, end), where row j of
+/// columns is the syndrome of an error at j. Moving to the next pattern only XORs the columns
+/// of the positions that changed, two for the revolving door
+template <class F>
+void forEachErrorSyndrome(const BitMatrix &columns, int w, uint64_t begin, uint64_t end, F &&f) {
+	Combinations		  patterns(columns.rows(), w);
+	int					  words = columns.words();
+	std::vector<uint64_t> s(words, 0);
+	auto				  flip	= [&](int j) {
+		 const uint64_t *col = columns.row(j);
+		 for (int i = 0; i < words; ++i)
+			 s[i] ^= col[i];
+	};
+
+	if (patterns.usesMasks()) {
+		patterns.forEachMask(begin, end, [&](uint64_t mask, uint64_t changed) {
+			for (; changed; changed &= changed - 1)
+				flip(std::countr_zero(changed));
+			f(ErrorPattern{mask, nullptr}, s.data());
+		});
+	} else {
+		patterns.forEachSet(begin, end, [&](const std::vector<int> &c, int out, int in) {
+			if (out < 0)
+				for (int p : c)
+					flip(p);
+			else {
+				flip(out);
+				flip(in);
+			}
+			f(ErrorPattern{0, &c}, s.data());
+		});
+	}
+}
+
+/// forEachErrorSyndrome over every error of weight w
+template <class F>
+void forEachErrorSyndrome(const BitMatrix &columns, int w, F &&f) {
+	forEachErrorSyndrome(columns, w, 0, Combinations(columns.rows(), w).count(), std::forward<F>(f));
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "code.hpp"
+#include "ndarray.hpp"
+#include "primitives.hpp"
+
+/// polynomials over GF(2) packed in a word, bit i is the coefficient of x^i
+namespace gf2poly {
+	inline int degree(uint64_t p) { return p ? 63 - std::countl_zero(p) : -1; }
+
+	inline uint64_t mod(uint64_t a, uint64_t m) {
+		int dm = degree(m);
+		for (int d = degree(a); d >= dm; d = degree(a))
+			a ^= m << (d - dm);
+		return a;
+	}
+
+	inline uint64_t gcd(uint64_t a, uint64_t b) {
+		while (b) {
+			a = mod(a, b);
+			std::swap(a, b);
+		}
+		return a;
+	}
+
+	/// (x^n + 1) mod m, for any n without needing a 65th bit
+	inline uint64_t xnPlusOneMod(int n, uint64_t m) {
+		int		 dm = degree(m);
+		uint64_t x	= mod(1, m);
+		for (int i = 0; i < n; ++i) {
+			x <<= 1;
+			if ((x >> dm) & 1) x ^= m;
+		}
+		return mod(x ^ 1, m);
+	}
+}	 // namespace gf2poly
+
+/// binary cyclic code of length n <= 64 given by its generator polynomial g(x), which divides
+/// x^n - 1. Word bit i is the coefficient of x^i, which is also column i of the generator
+/// matrix made of the shifts of g. Encoding is systematic: the message sits in the top k
+/// positions and the check bits are the remainder mod g, computed a byte at a time from a table
+class CyclicCode {
+	int		 n;
+	int		 r;		 // n - k, the degree of g
+	uint64_t g;
+	int		 t;
+
+	std::array<uint64_t, 256> byteTable;	  // b(x) x^r mod g for every byte b
+	std::vector<uint64_t>	  meggittTable;	  // sorted syndromes of the errors with bit n - 1 set
+
+	uint64_t mask(int bits) const { return bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1; }
+
+	/// one LFSR step: rem = rem * x + bit mod g
+	uint64_t shiftIn(uint64_t rem, uint64_t bit) const {
+		rem = (rem << 1) | bit;
+		return (rem >> r) & 1 ? rem ^ g : rem;
+	}
+
+	uint64_t rotate(uint64_t word) const { return ((word << 1) | (word >> (n - 1))) & mask(n); }
+
+	int minimumWeight() const {
+		// Gray code walk over all sums of the k shifts of g
+		int		 k	 = n - r;
+		int		 min = n;
+		uint64_t c	 = 0;
+		for (uint64_t i = 1; i < (uint64_t(1) << k); ++i) {
+			c ^= g << std::countr_zero(i);
+			min = std::min(min, std::popcount(c));
+		}
+		return min;
+	}
+
+	void buildMeggittTable() {
+		std::vector<uint64_t> columns(n);
+		for (int j = 0; j < n; ++j)
+			columns[j] = remainder(uint64_t(1) << j, n);
+
+		// every error of weight <= t with an error at position n - 1
+		auto add = [&](auto &self, int from, int left, uint64_t s) -> void {
+			meggittTable.push_back(s);
+			if (left == 0) return;
+			for (int j = from; j < n - 1; ++j)
+				self(self, j + 1, left - 1, s ^ columns[j]);
+		};
+		if (t > 0) add(add, 0, t - 1, columns[n - 1]);
+		std::sort(meggittTable.begin(), meggittTable.end());
+	}
+
+   public:
+	/// t is the number of errors to correct, by default (d - 1) / 2 with d found by enumerating the code
+	CyclicCode(int n, uint64_t g, int t = -1) : n(n), r(gf2poly::degree(g)), g(g), t(t) {
+		if (n < 2 || n > 64) throw std::runtime_error("cyclic codes are limited to lengths up to 64");
+		if (r < 1 || r >= n || gf2poly::xnPlusOneMod(n, g) != 0)
+			throw std::runtime_error("generator polynomial does not divide x^n - 1");
+
+		for (int b = 0; b < 256; ++b) {
+			uint64_t rem = 0;
+			for (int i = 7; i >= 0; --i)
+				rem = shiftIn(rem, (b >> i) & 1);
+			for (int i = 0; i < r; ++i)
+				rem = shiftIn(rem, 0);
+			byteTable[b] = rem;
+		}
+
+		if (this->t < 0) {
+			if (n - r > 32) throw std::runtime_error("the number of correctable errors is needed for k > 32");
+			this->t = (minimumWeight() - 1) / 2;
+		}
+		buildMeggittTable();
+	}
+
+	/// the generator polynomial of a binary code if the code is cyclic: the gcd of every row
+	/// with x^n - 1 generates a cyclic code containing the rows, equal to it when the dimensions match
+	static std::optional<CyclicCode> fromLinearCode(LinearCode &code) {
+		int n = code.length();
+		if (n > 64) return std::nullopt;
+
+		uint64_t g = 0;
+		for (int i = 0; i < code.blockLength(); ++i) {
+			uint64_t row = 0;
+			for (int j = 0; j < n; ++j)
+				if (int(code.generator[i][j]) & 1) row |= uint64_t(1) << j;
+			g = g ? gf2poly::gcd(g, row) : row;
+		}
+		if (!g) return std::nullopt;
+		g = gf2poly::gcd(g, gf2poly::xnPlusOneMod(n, g));
+		if (gf2poly::degree(g) != code.redundancy()) return std::nullopt;
+
+		return CyclicCode(n, g, (code.getDistance() - 1) / 2);
+	}
+
+	int		 length() const { return n; }
+	int		 blockLength() const { return n - r; }
+	int		 redundancy() const { return r; }
+	int		 correctable() const { return t; }
+	uint64_t generatorPolynomial() const { return g; }
+	/// number of syndromes the decoder stores, about 1 / n of a full syndrome table
+	std::size_t tableSize() const { return meggittTable.size(); }
+
+	/// word(x) mod g(x) for a word of the given number of bits, highest coefficients first
+	uint64_t remainder(uint64_t word, int bits) const {
+		uint64_t rem = 0;
+		int		 i	 = bits;
+		if (r < 8) {
+			while (i > 0)
+				rem = shiftIn(rem, (word >> --i) & 1);
+			return rem;
+		}
+		while (i % 8)
+			rem = shiftIn(rem, (word >> --i) & 1);
+		for (uint64_t low = mask(r - 8); i > 0;) {
+			i -= 8;
+			rem = byteTable[rem >> (r - 8)] ^ ((rem & low) << 8) ^ ((word >> i) & 0xff);
+		}
+		return rem;
+	}
+
+	uint64_t sindrome(uint64_t word) const { return remainder(word, n); }
+
+	/// m(x) x^r + (m(x) x^r mod g(x))
+	uint64_t encode(uint64_t message) const {
+		uint64_t shifted = message << r;
+		return shifted | remainder(shifted, n);
+	}
+	uint64_t message(uint64_t codeword) const { return codeword >> r; }
+
+	/// Meggitt decoding: the syndrome of the word rotated i times is the syndrome shifted i
+	/// times through the LFSR, so only errors in the last position need a table lookup
+	std::optional<uint64_t> correct(uint64_t word) const {
+		uint64_t s = sindrome(word);
+		if (!s) return word;
+
+		uint64_t last = remainder(uint64_t(1) << (n - 1), n);
+		for (int i = 0; i < n; ++i) {
+			if (std::binary_search(meggittTable.begin(), meggittTable.end(), s)) {
+				word ^= uint64_t(1) << (n - 1);
+				s ^= last;
+			}
+			word = rotate(word);
+			s	 = shiftIn(s, 0);
+		}
+		if (s) return std::nullopt;
+		return word;
+	}
+
+	template <class Arr>
+	static uint64_t pack(Arr &&word) {
+		auto [len]	 = word.shape();
+		uint64_t res = 0;
+		for (int j = 0; j < len; ++j)
+			if (int(word[j]) & 1) res |= uint64_t(1) << j;
+		return res;
+	}
+	template <class Arr>
+	static void unpack(uint64_t bits, Arr &&word) {
+		auto [len] = word.shape();
+		for (int j = 0; j < len; ++j)
+			word[j] = int((bits >> j) & 1);
+	}
+
+	/// systematic codeword of a message of length k, allocated from arena when one is given
+	template <NDLike Arr, class... Alloc>
+	NDArray<int, int> encode(Arr &&message, Alloc &...arena) const {
+		NDArray<int, int> res = Zeros((_, n), type<int>, arena...);
+		unpack(encode(pack(message)), res);
+		return res;
+	}
+
+	/// corrects a received word in place, false if it has more errors than the decoder can find
+	template <NDLike Arr>
+	bool correct(Arr &&word) const {
+		auto c = correct(pack(word));
+		if (!c) return false;
+		unpack(*c, word);
+		return true;
+	}
+
+	/// the shifts of g as the rows of a k x n generator matrix
+	NDArray<int, int, int> generatorMatrix() const {
+		NDArray<int, int, int> G = Zeros((_, n - r, n), type<int>);
+		for (int i = 0; i < n - r; ++i)
+			unpack(g << i, G[i]);
+		return G;
+	}
+};
@@ -1,68 +1,389 @@
 #pragma once
 
+#include <atomic>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "code.hpp"
+#include "combinations.hpp"
 #include "nd.hpp"
+#include "metrics.hpp"
 #include "ndarray.hpp"
+#include "parallel.hpp"
 #include "primitives.hpp"
+#include "shared.hpp"
+#include "trace.hpp"
+
+/// open addressing hash table from packed syndromes of up to 64 bits to the coset leader
+/// (weight, rank) of their error, filled by several threads at once. A slot is claimed with a
+/// compare-and-swap on its key, so the first leader stored for a syndrome stays. The zero
+/// syndrome is the empty slot marker and is never stored
+class SindromeTable {
+	std::vector<std::atomic<uint64_t>> storage;	   // the slots when the table owns them
+	std::atomic<uint64_t>			  *keys, *values;
+	std::size_t						   slots;
+	int								   bits;
+	std::atomic<std::size_t>		   count = 0;
+
+	std::size_t slot(uint64_t key) const { return (key * 0x9e3779b97f4a7c15ull) >> (64 - bits); }
+
+	void place(uint64_t entries, std::atomic<uint64_t> *memory) {
+		slots  = slotsFor(entries);
+		bits   = std::countr_zero(slots);
+		keys   = memory;
+		values = memory + slots;
+	}
+
+   public:
+	/// room for the given number of entries at a load factor of at most 1/2
+	explicit SindromeTable(uint64_t entries) : storage(2 * slotsFor(entries)) { place(entries, storage.data()); }
+	/// the same table in bytesFor(entries) bytes of memory that outlives it, zeroed for an
+	/// empty table. A filled table can be in read-only memory as long as nothing is inserted
+	SindromeTable(uint64_t entries, void *memory) { place(entries, static_cast<std::atomic<uint64_t> *>(memory)); }
+
+	static std::size_t slotsFor(uint64_t entries) { return std::bit_ceil(std::max<uint64_t>(2, 2 * entries)); }
+	static std::size_t bytesFor(uint64_t entries) { return 2 * slotsFor(entries) * sizeof(std::atomic<uint64_t>); }
+
+	static uint64_t leader(int weight, uint64_t rank) { return uint64_t(weight) << 56 | rank; }
+	static int		weightOf(uint64_t leader) { return leader >> 56; }
+	static uint64_t rankOf(uint64_t leader) { return leader & ((uint64_t(1) << 56) - 1); }
+
+	/// false if the syndrome already has a leader
+	bool insert(uint64_t sindrome, uint64_t leader) {
+		for (std::size_t i = slot(sindrome);; i = (i + 1) & (slots - 1)) {
+			uint64_t expected = 0;
+			if (keys[i].compare_exchange_strong(expected, sindrome, std::memory_order_acq_rel)) {
+				values[i].store(leader, std::memory_order_release);
+				++count;
+				return true;
+			}
+			if (expected == sindrome) return false;
+		}
+	}
+
+	std::optional<uint64_t> find(uint64_t sindrome) const {
+		for (std::size_t i = slot(sindrome);; i = (i + 1) & (slots - 1)) {
+			uint64_t key = keys[i].load(std::memory_order_acquire);
+			if (key == 0) return std::nullopt;
+			if (key != sindrome) continue;
+			// the key is published before its value
+			uint64_t value;
+			while (!(value = values[i].load(std::memory_order_acquire)))
+				std::this_thread::yield();
+			return value;
+		}
+	}
 
-class SindromeDecoder {
+	/// entries inserted through this object
+	std::size_t size() const { return count; }
+};
+
+/// how a decoder fills its table: before the constructor returns, or on a background thread
+/// while words are already being decoded
+enum class WarmUp { Blocking, Background };
+
+/// where a binary decoder keeps its table: in the process, or in a shared memory segment named
+/// after the code that every process decoding the same code maps read-only
+enum class TableStorage { Private, Shared };
+
+/// syndrome table decoder for codes over the symbols Sym. Binary codes keep their table in
+/// a SindromeTable built in parallel, weight by weight, from ranges of combination ranks.
+/// With WarmUp::Background every finished weight is published at once, and a syndrome that
+/// is not in the table yet is looked for among the errors of the weights still missing
+template <class Sym = int>
+class BasicSindromeDecoder {
 	struct TableEntry {
-		NDArray<int, int> e;
-		NDArray<int, int> sindrome;
+		NDArray<Sym, int> e;
+		NDArray<Sym, int> sindrome;
+		int				  weight;
 
-		TableEntry(NDArray<int, int> e, NDArray<int, int> sindrome) : e(e), sindrome(sindrome) {}
+		TableEntry(NDArray<Sym, int> e, NDArray<Sym, int> sindrome, int weight)
+			: e(e), sindrome(sindrome), weight(weight) {}
 	};
 
-	std::vector<TableEntry> sindromes;
-	LinearCode			   &code;
+	std::vector<TableEntry>		 sindromes;
+	std::optional<SindromeTable> table;
+	std::vector<Combinations>	 patterns;	  // error positions of every weight up to t
+	BasicLinearCode<Sym>		&code;
+	int							 t;
 
-   public:
-	SindromeDecoder(LinearCode &code) : code(code) {
-		int dist = code.getDistance();
-		std::cerr << std::format("initializing decodeer for [{}, {}, {}]-code", code.length(), code.blockLength(), dist)
-				  << std::endl;
-		// std::cerr << std::format("\n r(C) = {}", , code.getCoverageRadius()) << std::endl;
+	std::atomic<int>  published = 0;	  // every error up to this weight is in the table
+	std::atomic<bool> cancelled = false;
+	std::thread		  warmUp;
 
-		auto s0 = matmul_fancy(code.check, code.generator[0], type<int>);
-		s0.apply(mod2);
+	std::optional<SharedSegment> segment;
+	std::string					 segmentName;
 
-		int t = (dist - 1) / 2;
+	static constexpr uint64_t grain = 1 << 12;
 
-		for (auto &&e : ErrorVectors(code.length(), t)) {
-			// e.print(std::cout);
-			NDArray<int, int, int> s = matmul_fancy(code.check, e, type<int>);
-			s.apply(mod2);
+	/// the number of table entries
+	uint64_t preparePacked() {
+		const BitMatrix &columns = code.packedSyndromeMatrix();
+		if (columns.cols() > 64) throw std::runtime_error("syndrome tables are limited to n - k <= 64");
 
-			sindromes.emplace_back(e, NDArray((_, code.blockLength()), type<int>));
+		uint64_t entries = 0;
+		for (int w = 0; w <= t; ++w) {
+			patterns.emplace_back(code.length(), w);
+			entries += patterns.back().count();
+		}
+		return entries;
+	}
+
+	/// FNV-1a over the shape, t and check^t
+	static uint64_t segmentKey(const BitMatrix &columns, int t) {
+		uint64_t key = 0xcbf29ce484222325;
+		auto	 mix = [&](uint64_t x) {
+			for (int i = 0; i < 8; ++i, x >>= 8)
+				key = (key ^ (x & 0xff)) * 0x100000001b3;
+		};
+		mix(columns.rows());
+		mix(columns.cols());
+		mix(t);
+		for (int i = 0; i < columns.rows(); ++i)
+			for (int w = 0; w < columns.words(); ++w)
+				mix(columns.row(i)[w]);
+		return key;
+	}
+	static std::string segmentNameOf(uint64_t key) {
+		char name[32];
+		std::snprintf(name, sizeof(name), "/sindrome-%016llx", (unsigned long long)key);
+		return name;
+	}
+
+	/// maps the shared table of the code, building it if this is the first process to ask.
+	/// The segment starts with check^t, so a name collision is noticed. False when it cannot
+	/// be used, and the table then has to be built privately
+	bool shareTable(uint64_t entries) {
+		const BitMatrix &columns = code.packedSyndromeMatrix();
+		std::size_t		 matrix	 = std::size_t(columns.rows()) * columns.words() * sizeof(uint64_t);
+		uint64_t		 key	 = segmentKey(columns, t);
+		std::string		 name	 = segmentNameOf(key);
 
-			NDArray<int, int> &sind = sindromes.back().sindrome;
-			for (std::size_t i = 0; i < sind.size(); ++i) {
-				sind[i] = s[i][0];
+		try {
+			segment.emplace(name, key, matrix + SindromeTable::bytesFor(entries), [&](void *data) {
+				if (matrix) std::memcpy(data, columns.row(0), matrix);
+				table.emplace(entries, static_cast<char *>(data) + matrix);
+				fillPacked();
+				std::cerr << "initialization done" << std::endl;
+			});
+			if (matrix && std::memcmp(segment->data(), columns.row(0), matrix) != 0)
+				throw std::runtime_error("shared memory " + name + " holds another code");
+		} catch (const std::exception &e) {
+			std::cerr << e.what() << ", building a private table" << std::endl;
+			segment.reset();
+			table.reset();
+			return false;
+		}
+		segmentName = name;
+		if (!segment->built()) {
+			table.emplace(entries, static_cast<char *>(segment->data()) + matrix);
+			std::cerr << "attached to " << segmentName << std::endl;
+		}
+		published = t;
+		return true;
+	}
+
+	void fillPacked() {
+		TRACE_SCOPE("SindromeDecoder table");
+		const BitMatrix &columns = code.packedSyndromeMatrix();
+		for (int w = 1; w <= t && !cancelled; ++w) {
+			ThreadPool::shared().parallelFor(0, patterns[w].count(), grain, [&](uint64_t b, uint64_t e) {
+				if (cancelled) return;
+				uint64_t rank = b;
+				forEachErrorSyndrome(columns, w, b, e, [&](const ErrorPattern &, const uint64_t *s) {
+					table->insert(s[0], SindromeTable::leader(w, rank++));
+				});
+			});
+			published = w;
+		}
+	}
+
+	/// the leader of a syndrome among the errors heavier than from, the slow way
+	std::optional<uint64_t> searchLeader(uint64_t s, int from) const {
+		const BitMatrix &columns = code.packedSyndromeMatrix();
+		for (int w = from + 1; w <= t; ++w) {
+			std::optional<uint64_t> res;
+			for (uint64_t b = 0; b < patterns[w].count() && !res; b += grain) {
+				uint64_t rank = b;
+				forEachErrorSyndrome(columns, w, b, std::min(patterns[w].count(), b + grain),
+									 [&](const ErrorPattern &, const uint64_t *syn) {
+										 if (syn[0] == s) res = SindromeTable::leader(w, rank);
+										 ++rank;
+									 });
 			}
+			if (res) return res;
 		}
-		std::cerr << "initialization done" << std::endl;
+		return std::nullopt;
+	}
+
+	/// the error positions of a leader
+	std::vector<int> positionsOf(uint64_t leader) const {
+		std::vector<int>	c;
+		const Combinations &errors = patterns[SindromeTable::weightOf(leader)];
+		if (errors.usesMasks()) {
+			for (uint64_t m = errors.unrankMask(SindromeTable::rankOf(leader)); m; m &= m - 1)
+				c.push_back(std::countr_zero(m));
+		} else errors.unrank(SindromeTable::rankOf(leader), c);
+		return c;
 	}
 
-	auto decode(NDArray<int, int> &codeword) {
-		auto s = matmul_fancy(code.check, codeword, type<int>);
-		s.apply(mod2);
-		NDArray sind = NDArray((_, code.blockLength()), type<int>);
-		for (std::size_t i = 0; i < sind.size(); ++i) {
-			sind[i] = s[i][0];
+   public:
+	/// t = (d - 1) / 2 comes from distance when it is given and from the code's cached distance otherwise.
+	/// A shared table is built by the first process before its constructor returns, whatever the mode
+	BasicSindromeDecoder(BasicLinearCode<Sym> &code, int distance = -1, WarmUp mode = WarmUp::Blocking,
+						 TableStorage storage = TableStorage::Private)
+		: code(code) {
+		TRACE_SCOPE("SindromeDecoder");
+		int dist = distance > 0 ? distance : code.getDistance();
+		std::cerr << std::format("initializing decodeer for [{}, {}, {}]-code", code.length(), code.blockLength(), dist)
+				  << std::endl;
+		// std::cerr << std::format("\n r(C) = {}", , code.getCoverageRadius()) << std::endl;
+
+		t = (dist - 1) / 2;
+
+		if constexpr (isBinary<Sym>) {
+			uint64_t entries = preparePacked();
+			if (storage == TableStorage::Shared && shareTable(entries)) return;
+			table.emplace(entries);
+			// the worker stays quiet, its output would land in the middle of the decoded blocks
+			if (mode == WarmUp::Background) warmUp = std::thread([this] { fillPacked(); });
+			else {
+				fillPacked();
+				std::cerr << "initialization done" << std::endl;
+			}
+		} else {
+			forEachErrorVector<Sym>(code.length(), t, [&](auto &e, int weight) {
+				// e.print(std::cout);
+				sindromes.emplace_back(e, code.sindrome(e), weight);
+			});
+			published = t;
+			std::cerr << "initialization done" << std::endl;
 		}
+	}
+	BasicSindromeDecoder(const BasicSindromeDecoder &) = delete;
+	~BasicSindromeDecoder() {
+		cancelled = true;
+		if (warmUp.joinable()) warmUp.join();
+	}
 
-		for (auto &&entry : sindromes) {
-			if (entry.sindrome.operator==(sind)) {
-				codeword += entry.e;
-				codeword.apply(mod2);
+	/// name of the shared memory segment with the table, empty for a private table
+	const std::string &sharedName() const { return segmentName; }
+	/// name of the shared table a decoder of the code would use, whether it exists or not.
+	/// Shared tables outlive the processes using them, SharedSegment::remove deletes one
+	static std::string sharedNameFor(BasicLinearCode<Sym> &code, int distance = -1)
+		requires(isBinary<Sym>)
+	{
+		int dist = distance > 0 ? distance : code.getDistance();
+		return segmentNameOf(segmentKey(code.packedSyndromeMatrix(), (dist - 1) / 2));
+	}
+
+	/// every error up to this weight is in the table, the table is complete at t
+	int	 readyWeight() const { return published; }
+	bool ready() const { return published == t; }
+	void waitReady() {
+		if (warmUp.joinable()) warmUp.join();
+	}
+
+	/// the registry decoding records to, the one of the code
+	Metrics &metrics() { return code.metrics(); }
 
-				auto y = solve(code.generator, codeword);
+	auto decode(NDArray<Sym, int> &codeword) {
+		TRACE_SCOPE("decode");
+		Metrics &stats = metrics();
+		stats.add(Metrics::BlocksDecoded);
+		auto failed = [&] {
+			stats.add(Metrics::DecodeFailures);
+			std::cerr << "failed decoding" << std::endl;
+			std::cerr << std::endl;
+			return NDArray((_, 0), type<Sym>);
+		};
+
+		if constexpr (isBinary<Sym>) {
+			uint64_t s = 0;
+			{
+				Metrics::Timer timer(stats, Metrics::Sindrome);
+				if (code.redundancy() > 0) s = code.packedSindrome(BitMatrix::fromND(codeword)).row(0)[0];
+			}
+			if (s) {
+				std::optional<uint64_t> leader;
+				{
+					Metrics::Timer timer(stats, Metrics::Lookup);
+					// read before the lookup, so a level finished in between is not skipped
+					int done = published;
+					leader	 = table->find(s);
+					stats.add(leader ? Metrics::TableHits : Metrics::TableMisses);
+					if (!leader && done < t) leader = searchLeader(s, done);
+				}
+				if (!leader) return failed();
+
+				Metrics::Timer	 timer(stats, Metrics::Extract);
+				std::vector<int> c = positionsOf(*leader);
+				for (int j : c)
+					codeword[j] = 1 - int(codeword[j]);
+				stats.corrected(c.size());
+				return solve(code.generator, codeword);
+			}
+			Metrics::Timer timer(stats, Metrics::Extract);
+			stats.corrected(0);
+			return solve(code.generator, codeword);
+		} else {
+			// every temporary of one block comes from the thread's scratch arena
+			Arena::Scope	  scratch;
+			NDArray<Sym, int> sind = [&] {
+				Metrics::Timer timer(stats, Metrics::Sindrome);
+				return code.sindrome(codeword, scratch.arena);
+			}();
 
-				return y;
+			TableEntry *found = nullptr;
+			{
+				Metrics::Timer timer(stats, Metrics::Lookup);
+				for (auto &&entry : sindromes) {
+					if (entry.sindrome.operator==(sind)) {
+						found = &entry;
+						break;
+					}
+				}
+				stats.add(found ? Metrics::TableHits : Metrics::TableMisses);
 			}
+			if (!found) return failed();
+
+			Metrics::Timer timer(stats, Metrics::Extract);
+			codeword = map(codeword - found->e, FieldTraits<Sym>::reduce);
+			stats.corrected(found->weight);
+
+			auto y = solve(code.generator, codeword);
+
+			return y;
 		}
-		std::cerr << "failed decoding" << std::endl;
-		std::cerr << std::endl;
-		return NDArray((_, 0), type<int>);
+	}
+
+	/// corrects a packed binary word in place without solving for its message, false when no
+	/// error up to weight t has its syndrome. Records and prints nothing, it is the building
+	/// block of decoders made from this one
+	bool correct(uint64_t *word) const
+		requires isBinary<Sym>
+	{
+		if (code.redundancy() == 0) return true;
+		const BitMatrix &columns = code.packedSyndromeMatrix();
+		uint64_t		 s		 = 0;
+		for (int w = 0; w < BitMatrix::wordsFor(code.length()); ++w)
+			for (uint64_t bits = word[w]; bits; bits &= bits - 1)
+				s ^= columns.row(w * BitMatrix::wordBits + std::countr_zero(bits))[0];
+		if (!s) return true;
+
+		int						done   = published;
+		std::optional<uint64_t> leader = table->find(s);
+		if (!leader && done < t) leader = searchLeader(s, done);
+		if (!leader) return false;
+		for (int j : positionsOf(*leader))
+			word[j / BitMatrix::wordBits] ^= uint64_t(1) << (j % BitMatrix::wordBits);
+		return true;
 	}
 };
+
+using SindromeDecoder = BasicSindromeDecoder<int>;
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "bigint.hpp"
+#include "bitmatrix.hpp"
+#include "code.hpp"
+#include "parallel.hpp"
+#include "ple.hpp"
+#include "trace.hpp"
+#include "weights.hpp"
+
+/// a permutation of the positions of a code, position j goes to position p[j]
+using Permutation = std::vector<int>;
+
+/// the words of weight at most w in the span of the rows of basis for the smallest w at which
+/// they span it, the invariant set the canonical form refines against. Enumerated in Gray code
+/// order on the threads like enumerateWeights
+inline BitMatrix lowWeightWords(const BitMatrix &basis, std::size_t limit = 1 << 18) {
+	TRACE_SCOPE("lowWeightWords");
+	int d = basis.rows(), n = basis.cols(), words = basis.words();
+	if (d == 0) return BitMatrix(0, n);
+	std::vector<uint64_t> histogram = enumerateWeights(basis);
+
+	int		 chunkBits = d >= 16 ? std::min(d, int(std::bit_width(unsigned(hardwareThreads()) * 4))) : 0;
+	int		 chunks	   = 1 << chunkBits;
+	uint64_t size	   = uint64_t(1) << (d - chunkBits);
+
+	std::size_t count = 0;
+	for (int w = 1; w <= n; ++w) {
+		count += histogram[w];
+		if (!histogram[w]) continue;
+		if (count > limit) throw std::runtime_error("too many low weight words to refine against");
+
+		std::vector<std::vector<uint64_t>> partial(chunks);
+		parallelFor(0, chunks, 1, [&](int b, int e) {
+			std::vector<uint64_t> word(words);
+			for (int c = b; c < e; ++c) {
+				uint64_t begin = c * size;
+				std::fill(word.begin(), word.end(), 0);
+				for (uint64_t gray = begin ^ (begin >> 1); gray; gray &= gray - 1) {
+					const uint64_t *row = basis.row(std::countr_zero(gray));
+					for (int x = 0; x < words; ++x)
+						word[x] ^= row[x];
+				}
+				for (uint64_t i = begin;; ++i) {
+					int weight = 0;
+					for (int x = 0; x < words; ++x)
+						weight += std::popcount(word[x]);
+					if (weight > 0 && weight <= w) partial[c].insert(partial[c].end(), word.begin(), word.end());
+					if (i + 1 == begin + size) break;
+					const uint64_t *row = basis.row(std::countr_zero(i + 1));
+					for (int x = 0; x < words; ++x)
+						word[x] ^= row[x];
+				}
+			}
+		});
+
+		BitMatrix res(count, n);
+		int		  i = 0;
+		for (auto &part : partial)
+			for (std::size_t at = 0; at < part.size(); at += words, ++i)
+				std::copy_n(part.data() + at, words, res.row(i));
+		if (Echelon(res).rank() == d) return res;
+	}
+	throw std::runtime_error("basis rows are not independent");
+}
+
+/// canonical form of a binary linear code under permutations of its positions, with the
+/// generators of its automorphism group, found like nauty: positions are colored by partition
+/// refinement against the low weight words of the code or of its dual, whichever has the
+/// smaller dimension, and a search tree individualizes one position at a time until the
+/// coloring is discrete. Every leaf labels the positions, and the canonical form is the least
+/// reduced echelon generator over the leaves. Leaves giving the same form as the first one
+/// are automorphisms, which prune the siblings in their orbits on the first path.
+/// The enumeration and the refinement of large word sets run on the threads
+class CanonicalForm {
+	int						 n;
+	BitMatrix				 generator;
+	std::vector<std::vector<int>> wordPositions;	// the positions of every low weight word
+	std::vector<std::vector<int>> positionWords;	// the low weight words through every position
+
+	struct Leaf {
+		std::vector<int> labeling;
+		BitMatrix		 form;
+	};
+	std::optional<Leaf>		 first, best;
+	std::vector<int>		 firstPath;		 // the position individualized at every level of the first path
+	std::vector<Permutation> generators;
+
+	/// dense colors 0 .. c - 1 ordered by key(i), key(i) < key(j) gives i a smaller color
+	template <class Key>
+	static std::vector<int> rank(int count, Key &&key) {
+		std::vector<std::vector<int>> keys(count);
+		auto fill = [&](uint64_t b, uint64_t e) {
+			for (uint64_t i = b; i < e; ++i)
+				keys[i] = key(i);
+		};
+		if (count >= 4096) ThreadPool::shared().parallelFor(0, count, 1024, fill);
+		else fill(0, count);
+
+		std::vector<int> order(count);
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+		std::vector<int> res(count);
+		for (int i = 0, c = 0; i < count; ++i) {
+			if (i > 0 && keys[order[i]] != keys[order[i - 1]]) ++c;
+			res[order[i]] = c;
+		}
+		return res;
+	}
+
+	static int colorsOf(const std::vector<int> &colors) {
+		return colors.empty() ? 0 : *std::max_element(colors.begin(), colors.end()) + 1;
+	}
+
+	/// splits the cells of the positions until every position of a cell lies in the same
+	/// number of words of every word color, and every word of a color meets every cell equally
+	void refine(std::vector<int> &colors) const {
+		for (int cells = colorsOf(colors); cells < n;) {
+			std::vector<int> wordColors = rank(wordPositions.size(), [&](int w) {
+				std::vector<int> key;
+				for (int p : wordPositions[w])
+					key.push_back(colors[p]);
+				std::sort(key.begin(), key.end());
+				return key;
+			});
+			colors = rank(n, [&](int p) {
+				std::vector<int> key;
+				for (int w : positionWords[p])
+					key.push_back(wordColors[w]);
+				std::sort(key.begin(), key.end());
+				key.insert(key.begin(), colors[p]);
+				return key;
+			});
+			int now = colorsOf(colors);
+			if (now == cells) break;
+			cells = now;
+		}
+	}
+
+	/// the reduced echelon generator of the code with position j moved to labeling[j]
+	BitMatrix formOf(const std::vector<int> &labeling) const {
+		BitMatrix columns = generator.transposed();
+		BitMatrix moved(n, generator.rows());
+		for (int j = 0; j < n; ++j)
+			std::copy_n(columns.row(j), columns.words(), moved.row(labeling[j]));
+		Echelon e(moved.transposed());
+		return e.reduced().block(0, 0, e.rank(), n);
+	}
+
+	/// the automorphism taking the labeling of leaf to the one of other
+	Permutation automorphism(const std::vector<int> &leaf, const std::vector<int> &other) const {
+		std::vector<int> inverse(n);
+		for (int j = 0; j < n; ++j)
+			inverse[other[j]] = j;
+		Permutation res(n);
+		for (int j = 0; j < n; ++j)
+			res[j] = inverse[leaf[j]];
+		return res;
+	}
+
+	/// orbit representatives of the group generated by the generators fixing the first fixed
+	/// positions of the first path, all of them for fixed = -1
+	std::vector<int> orbitsFixing(int fixed) const {
+		std::vector<int> parent(n);
+		std::iota(parent.begin(), parent.end(), 0);
+		auto find = [&](int x) {
+			while (parent[x] != x)
+				x = parent[x] = parent[parent[x]];
+			return x;
+		};
+		for (const Permutation &g : generators) {
+			bool fixes = true;
+			for (int l = 0; l < fixed && fixes; ++l)
+				fixes = g[firstPath[l]] == firstPath[l];
+			if (!fixes) continue;
+			for (int j = 0; j < n; ++j) {
+				int a = find(j), b = find(g[j]);
+				if (a != b) parent[std::max(a, b)] = std::min(a, b);
+			}
+		}
+		for (int j = 0; j < n; ++j)
+			parent[j] = find(j);
+		return parent;
+	}
+
+	/// searches the subtree below a coloring at the given level, common of its first levels
+	/// being the first path. Returns the level to go back to: an automorphism mapping the first
+	/// path onto this one makes the rest of the subtree below the first path node redundant
+	int search(std::vector<int> colors, int level, int common) {
+		refine(colors);
+		if (colorsOf(colors) == n) {
+			BitMatrix form = formOf(colors);
+			if (!first) {
+				first.emplace(colors, form);
+				best.emplace(colors, form);
+				return level;
+			}
+			if (same(form, first->form)) {
+				generators.push_back(automorphism(colors, first->labeling));
+				return common;
+			}
+			if (same(form, best->form)) generators.push_back(automorphism(colors, best->labeling));
+			else if (less(form, best->form)) best.emplace(colors, form);
+			return level;
+		}
+
+		std::vector<int> size(n, 0);
+		for (int c : colors)
+			++size[c];
+		int				 target = std::find_if(size.begin(), size.end(), [](int s) { return s > 1; }) - size.begin();
+		std::vector<int> cell;
+		for (int j = 0; j < n; ++j)
+			if (colors[j] == target) cell.push_back(j);
+
+		bool			 onFirst = common == level;
+		std::vector<int> explored;
+		for (int v : cell) {
+			if (onFirst && !explored.empty()) {
+				std::vector<int> orbit = orbitsFixing(level);
+				if (std::any_of(explored.begin(), explored.end(), [&](int u) { return orbit[u] == orbit[v]; })) continue;
+			}
+			if (onFirst && explored.empty()) firstPath.push_back(v);
+			explored.push_back(v);
+
+			std::vector<int> child(n);
+			for (int j = 0; j < n; ++j)
+				child[j] = colors[j] + (colors[j] > target || (colors[j] == target && j != v));
+			int back = search(std::move(child), level + 1, onFirst && explored.size() == 1 ? level + 1 : common);
+			if (back < level) return back;
+		}
+		return level;
+	}
+
+   public:
+	/// generator rows must be independent
+	explicit CanonicalForm(const BitMatrix &generator) : n(generator.cols()), generator(generator) {
+		TRACE_SCOPE("CanonicalForm");
+		int k = generator.rows();
+		if (std::min(k, n - k) > 32) throw std::runtime_error("code and dual too large to enumerate low weight words");
+		Echelon e(generator);
+		if (e.rank() != k) throw std::runtime_error("generator does not have full rank");
+
+		BitMatrix words = k <= n - k ? lowWeightWords(generator) : lowWeightWords(e.nullspace());
+		wordPositions.resize(words.rows());
+		positionWords.resize(n);
+		for (int w = 0; w < words.rows(); ++w)
+			for (int x = 0; x < words.words(); ++x)
+				for (uint64_t bits = words.row(w)[x]; bits; bits &= bits - 1) {
+					int p = x * BitMatrix::wordBits + std::countr_zero(bits);
+					wordPositions[w].push_back(p);
+					positionWords[p].push_back(w);
+				}
+
+		search(std::vector<int>(n, 0), 0, 0);
+	}
+
+	/// row by row lexicographic order of forms with the same shape
+	static bool less(const BitMatrix &a, const BitMatrix &b) {
+		for (int i = 0; i < a.rows(); ++i) {
+			auto res = std::lexicographical_compare_three_way(a.row(i), a.row(i) + a.words(), b.row(i),
+															  b.row(i) + b.words());
+			if (res != 0) return res < 0;
+		}
+		return false;
+	}
+	static bool same(const BitMatrix &a, const BitMatrix &b) { return !less(a, b) && !less(b, a); }
+
+	/// the least reduced echelon generator over every labeling of the positions, the same for
+	/// all permutation equivalent codes
+	const BitMatrix &form() const { return best->form; }
+	/// position j of the code is position labeling()[j] of form()
+	const Permutation &labeling() const { return best->labeling; }
+
+	/// generators of the group of position permutations that map the code onto itself
+	const std::vector<Permutation> &automorphisms() const { return generators; }
+
+	/// every position's smallest position in its orbit under the automorphisms. Positions in one
+	/// orbit are interchangeable, so a table decoder only needs the errors of one per orbit
+	std::vector<int> orbits() const { return orbitsFixing(-1); }
+
+	/// the order of the automorphism group: the product over the first path of the orbit sizes
+	/// of its positions in the stabilizers of the positions before them
+	BigInt groupOrder() const {
+		BigInt res = 1;
+		for (int l = 0; l < int(firstPath.size()); ++l) {
+			std::vector<int> orbit = orbitsFixing(l);
+			res *= BigInt(std::count(orbit.begin(), orbit.end(), orbit[firstPath[l]]));
+		}
+		return res;
+	}
+};
+
+/// a permutation moving every position j of code a to p[j] so that it becomes code b, nothing
+/// when the codes are not permutation equivalent. The canonical forms are found in parallel
+inline std::optional<Permutation> equivalence(const BitMatrix &a, const BitMatrix &b) {
+	if (a.rows() != b.rows() || a.cols() != b.cols()) return std::nullopt;
+	auto other = ThreadPool::shared().submit([&] { return CanonicalForm(b); });
+	CanonicalForm mine(a);
+	CanonicalForm theirs = ThreadPool::shared().wait(other);
+	if (!CanonicalForm::same(mine.form(), theirs.form())) return std::nullopt;
+
+	int				 n = a.cols();
+	std::vector<int> inverse(n);
+	for (int j = 0; j < n; ++j)
+		inverse[theirs.labeling()[j]] = j;
+	Permutation res(n);
+	for (int j = 0; j < n; ++j)
+		res[j] = inverse[mine.labeling()[j]];
+	return res;
+}
+
+inline std::optional<Permutation> equivalence(LinearCode &a, LinearCode &b) {
+	return equivalence(a.packedGenerator(), b.packedGenerator());
+}
@@ -1,23 +1,43 @@
 #pragma once
 #include "ndarray.hpp"
 #include "primitives.hpp"
+#include "field.hpp"
+#include "combinations.hpp"
+#include <numeric>
+#include <vector>
 
+/// all 0/1 vectors of length size with at most max_cnt ones, by increasing weight. Within a
+/// weight they come in revolving door order, so each step clears one entry and sets another
 class ErrorVectors {
    public:
 	class Iterator {
 		NDArray<int, int> vec;
+		std::vector<int>  positions;
+		int				  size;
 
 	   public:
 		int one_cnt;
-		Iterator(int size) : vec(Zeros((_, size), type<int>)), one_cnt(0) {}
+		Iterator(int size) : vec(Zeros((_, size), type<int>)), size(size), one_cnt(0) {}
 
 		bool operator!=(const Iterator &other) const { return one_cnt != other.one_cnt; }
 		bool operator==(const Iterator &other) const { return one_cnt == other.one_cnt; }
 
 		bool operator!=(const int &other) const { return one_cnt != other; }
 		void operator++() {
-			bool b = std::prev_permutation(vec.begin(), vec.end());
-			if (!b) { vec[one_cnt++] = 1; }
+			int out, in;
+			if (Combinations::nextRevolvingDoor(positions, size, out, in)) {
+				vec[out] = 0;
+				vec[in]	 = 1;
+				return;
+			}
+			// the first vector of the next weight is 1...10...0
+			for (int p : positions)
+				vec[p] = 0;
+			if (++one_cnt > size) return;
+			positions.resize(one_cnt);
+			std::iota(positions.begin(), positions.end(), 0);
+			for (int p : positions)
+				vec[p] = 1;
 		}
 
 		auto &operator*() { return vec; }
@@ -34,3 +54,42 @@ class ErrorVectors {
 	auto begin() const { return Iterator(size); }
 	auto end() const { return max_cnt + 1; }
 };
+
+/// calls f(e, weight) for every error vector over T of weight <= maxWeight, by increasing weight.
+/// over GF(2) these are the ErrorVectors, larger fields try every nonzero value on each support
+template <class T, class F>
+void forEachErrorVector(int size, int maxWeight, F &&f) {
+	ErrorVectors supports(size, maxWeight);
+	if constexpr (isBinary<T>) {
+		for (auto it = supports.begin(); it != supports.end(); ++it) {
+			f(*it, it.one_cnt);
+		}
+	} else {
+		NDArray<T, int>	 e = Zeros((_, size), type<T>);
+		std::vector<int> positions;
+		for (auto it = supports.begin(); it != supports.end(); ++it) {
+			positions.clear();
+			for (int i = 0; i < size; ++i)
+				if ((*it)[i] == 1) positions.push_back(i);
+			for (int p : positions)
+				e[p] = 1;
+
+			while (true) {
+				f(e, it.one_cnt);
+				// next assignment of nonzero values, an odometer over 1..q-1
+				std::size_t i = 0;
+				for (; i < positions.size(); ++i) {
+					int v = int(T(e[positions[i]])) + 1;
+					if (v < FieldTraits<T>::q) {
+						e[positions[i]] = v;
+						break;
+					}
+					e[positions[i]] = 1;
+				}
+				if (i == positions.size()) break;
+			}
+			for (int p : positions)
+				e[p] = 0;
+		}
+	}
+}
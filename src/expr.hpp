@@ -0,0 +1,146 @@
+#pragma once
+
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "autoref.hpp"
+#include <nd.hpp>
+
+/// an ND container of rank > 0, operators below are only enabled for those so
+/// that rank-0 arrays keep behaving like the scalars they convert to
+template <class T>
+concept NDArrayLike = NDLike<T> && (ndRank<T> > 0);
+
+/// lazy f(a) over every element of a
+template <class F, class A, class... Args>
+class UnaryExpr : public ND<UnaryExpr<F, A, Args...>, Args...>, public ExprBase {
+	using Parent = ND<UnaryExpr<F, A, Args...>, Args...>;
+
+	F		   f;
+	AutoRef<A> a;
+
+   public:
+	using Elem = std::invoke_result_t<F &, typename std::remove_reference_t<A>::Elem>;
+
+	template <class U>
+	UnaryExpr(F f, U &&a, std::tuple<Args...> dim) : Parent(dim), f(f), a(std::forward<U>(a)) {}
+
+	auto operator[](int index)
+		requires(sizeof...(Args) > 0)
+	{
+		return ::UnaryExpr(f, (*a)[index], pop_front(this->shape()));
+	}
+
+	Elem operator[]()
+		requires(sizeof...(Args) == 0)
+	{
+		return f((*a)[]);
+	}
+
+	operator Elem()
+		requires(sizeof...(Args) == 0)
+	{
+		return (*this)[];
+	}
+
+	Elem getLinear(std::size_t i)
+		requires Linear<A>
+	{
+		return f(a->getLinear(i));
+	}
+
+	auto &print(std::ostream &out, int space = 2) {
+		out << "UnaryExpr" << this->dimensions << std::endl;
+		this->printInt(out, space);
+		out << std::endl;
+		return *this;
+	}
+};
+
+template <class F, class U, class... Args>
+UnaryExpr(F, U &&, std::tuple<Args...>) -> UnaryExpr<F, U, Args...>;
+
+/// lazy f(a, b) over every pair of elements of equally shaped a and b
+template <class F, class A, class B, class... Args>
+class BinaryExpr : public ND<BinaryExpr<F, A, B, Args...>, Args...>, public ExprBase {
+	using Parent = ND<BinaryExpr<F, A, B, Args...>, Args...>;
+
+	F		   f;
+	AutoRef<A> a;
+	AutoRef<B> b;
+
+   public:
+	using Elem = std::invoke_result_t<F &, typename std::remove_reference_t<A>::Elem,
+									  typename std::remove_reference_t<B>::Elem>;
+
+	template <class U, class V>
+	BinaryExpr(F f, U &&a, V &&b, std::tuple<Args...> dim)
+		: Parent(dim), f(f), a(std::forward<U>(a)), b(std::forward<V>(b)) {
+		if (this->a->shape() != this->b->shape()) { throw std::runtime_error("ND dimensions do not match"); }
+	}
+
+	auto operator[](int index)
+		requires(sizeof...(Args) > 0)
+	{
+		return ::BinaryExpr(f, (*a)[index], (*b)[index], pop_front(this->shape()));
+	}
+
+	Elem operator[]()
+		requires(sizeof...(Args) == 0)
+	{
+		return f((*a)[], (*b)[]);
+	}
+
+	operator Elem()
+		requires(sizeof...(Args) == 0)
+	{
+		return (*this)[];
+	}
+
+	Elem getLinear(std::size_t i)
+		requires(Linear<A> && Linear<B>)
+	{
+		return f(a->getLinear(i), b->getLinear(i));
+	}
+
+	auto &print(std::ostream &out, int space = 2) {
+		out << "BinaryExpr" << this->dimensions << std::endl;
+		this->printInt(out, space);
+		out << std::endl;
+		return *this;
+	}
+};
+
+template <class F, class U, class V, class... Args>
+BinaryExpr(F, U &&, V &&, std::tuple<Args...>) -> BinaryExpr<F, U, V, Args...>;
+
+/// lazy version of ND::apply, nothing is computed until the result is assigned
+template <NDArrayLike A, class F>
+auto map(A &&a, F f) {
+	return UnaryExpr(f, std::forward<A>(a), a.shape());
+}
+
+template <class A, class S>
+concept ScalarFor = !NDArrayLike<S> && std::is_convertible_v<S, typename std::remove_cvref_t<A>::Elem>;
+
+#define ND_EXPR_OPERATOR(op, functor)                                                                   \
+	template <NDArrayLike A, NDArrayLike B>                                                             \
+	auto operator op(A &&a, B &&b) {                                                                    \
+		return BinaryExpr(functor(), std::forward<A>(a), std::forward<B>(b), a.shape());                \
+	}                                                                                                   \
+	template <NDArrayLike A, class S>                                                                   \
+		requires ScalarFor<A, S>                                                                        \
+	auto operator op(A &&a, S s) {                                                                      \
+		typename std::remove_cvref_t<A>::Elem v = s;                                                    \
+		return UnaryExpr([v](auto x) { return functor()(x, v); }, std::forward<A>(a), a.shape());      \
+	}
+
+ND_EXPR_OPERATOR(+, std::plus)
+ND_EXPR_OPERATOR(-, std::minus)
+ND_EXPR_OPERATOR(*, std::multiplies)
+ND_EXPR_OPERATOR(^, std::bit_xor)
+ND_EXPR_OPERATOR(&, std::bit_and)
+
+#undef ND_EXPR_OPERATOR
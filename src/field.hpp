@@ -0,0 +1,156 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+
+/// GF(P) for a prime P, elements are residues 0..P-1
+template <int P>
+struct PrimeField {
+	static_assert(P >= 2 && P <= 256, "field elements are stored in one byte");
+	static constexpr int q				= P;
+	static constexpr int characteristic = P;
+
+	static constexpr uint8_t add(uint8_t a, uint8_t b) {
+		int s = a + b;
+		return s >= P ? s - P : s;
+	}
+	static constexpr uint8_t neg(uint8_t a) { return a ? P - a : 0; }
+	static constexpr uint8_t fromInt(int x) {
+		x %= P;
+		return x < 0 ? x + P : x;
+	}
+	/// product without tables, only used to build them
+	static constexpr uint8_t slowMul(uint8_t a, uint8_t b) { return a * b % P; }
+};
+
+/// GF(2^M), elements are polynomials over GF(2) modulo the primitive polynomial Poly
+template <int M, int Poly>
+struct BinaryExtensionField {
+	static_assert(M >= 1 && M <= 8, "field elements are stored in one byte");
+	static_assert((Poly >> M) == 1, "Poly must have degree M");
+	static constexpr int q				= 1 << M;
+	static constexpr int characteristic = 2;
+
+	static constexpr uint8_t add(uint8_t a, uint8_t b) { return a ^ b; }
+	static constexpr uint8_t neg(uint8_t a) { return a; }
+	static constexpr uint8_t fromInt(int x) { return x & (q - 1); }
+	static constexpr uint8_t slowMul(uint8_t a, uint8_t b) {
+		int res = 0;
+		for (int x = a; b; b >>= 1, x <<= 1) {
+			if (x & q) x ^= Poly;
+			if (b & 1) res ^= x;
+		}
+		return res;
+	}
+};
+
+/// log/antilog tables over a generator of the multiplicative group
+template <class Field>
+struct FieldTables {
+	static constexpr int q = Field::q;
+
+	std::array<uint8_t, 2 * q> exp{};
+	std::array<uint8_t, q>	   log{};
+
+	constexpr FieldTables() {
+		int g = 1;
+		for (; g < q; ++g) {
+			int order = 1;
+			for (uint8_t x = g; x != 1; x = Field::slowMul(x, g))
+				++order;
+			if (order == q - 1) break;
+		}
+		uint8_t x = 1;
+		for (int i = 0; i < q - 1; ++i) {
+			exp[i] = x;
+			log[x] = i;
+			x	   = Field::slowMul(x, g);
+		}
+		for (int i = q - 1; i < 2 * q; ++i)
+			exp[i] = exp[i - (q - 1)];
+	}
+};
+
+/// one element of a finite field with at most 256 elements, stored in a byte
+template <class Field>
+class GF {
+	static constexpr FieldTables<Field> tables{};
+
+	uint8_t v = 0;
+
+	static constexpr GF raw(uint8_t x) {
+		GF res;
+		res.v = x;
+		return res;
+	}
+
+   public:
+	static constexpr int q = Field::q;
+
+	constexpr GF() = default;
+	constexpr GF(int x) : v(Field::fromInt(x)) {}
+
+	explicit constexpr operator int() const { return v; }
+
+	friend constexpr GF operator+(GF a, GF b) { return raw(Field::add(a.v, b.v)); }
+	friend constexpr GF operator-(GF a, GF b) { return raw(Field::add(a.v, Field::neg(b.v))); }
+	friend constexpr GF operator-(GF a) { return raw(Field::neg(a.v)); }
+	friend constexpr GF operator*(GF a, GF b) {
+		if (!a.v || !b.v) return GF();
+		return raw(tables.exp[tables.log[a.v] + tables.log[b.v]]);
+	}
+	friend constexpr GF operator/(GF a, GF b) { return a * b.inverse(); }
+
+	constexpr GF &operator+=(GF b) { return *this = *this + b; }
+	constexpr GF &operator-=(GF b) { return *this = *this - b; }
+	constexpr GF &operator*=(GF b) { return *this = *this * b; }
+
+	friend constexpr bool operator==(GF a, GF b) { return a.v == b.v; }
+
+	constexpr GF inverse() const {
+		assert(v && "zero has no inverse");
+		return raw(tables.exp[q - 1 - tables.log[v]]);
+	}
+
+	friend std::ostream &operator<<(std::ostream &out, GF a) { return out << int(a.v); }
+	friend std::istream &operator>>(std::istream &in, GF &a) {
+		int x;
+		in >> x;
+		a.v = Field::fromInt(x);
+		return in;
+	}
+};
+
+using GF3	= GF<PrimeField<3>>;
+using GF5	= GF<PrimeField<5>>;
+using GF7	= GF<PrimeField<7>>;
+using GF4	= GF<BinaryExtensionField<2, 0b111>>;
+using GF8	= GF<BinaryExtensionField<3, 0b1011>>;
+using GF16	= GF<BinaryExtensionField<4, 0b10011>>;
+using GF256 = GF<BinaryExtensionField<8, 0x11d>>;
+
+/// arithmetic of the alphabet a code is defined over
+template <class T>
+struct FieldTraits {
+	static constexpr int q = T::q;
+
+	static T reduce(T x) { return x; }
+	static T inverse(T x) { return x.inverse(); }
+};
+
+/// int symbols are GF(2) elements, integer arithmetic on them is only
+/// reduced with mod 2 where it matters, which keeps the binary path as it was
+template <>
+struct FieldTraits<int> {
+	static constexpr int q = 2;
+
+	static int reduce(int x) { return x & 1; }
+	static int inverse(int x) { return x; }
+};
+
+template <class T>
+constexpr bool isBinary = std::is_same_v<T, int>;
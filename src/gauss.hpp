@@ -1,110 +1,163 @@
 #pragma once
 
+#include <stdexcept>
 #include <tuple>
+#include <vector>
 #include <nd.hpp>
 #include <ndarray.hpp>
 #include <slice.hpp>
 #include <primitives.hpp>
+#include "ple.hpp"
+#include "trace.hpp"
 
-/// assumes [n,m] matrix and n <= m
+/// Gauss-Jordan elimination of the first `columns` columns, returns the rank found. Pivots are
+/// placed in rows 0, 1, ... in column order, so for a matrix of full rank the pivot of column j
+/// ends up in row j. A column without a pivot is skipped and the rows below keep waiting for one.
+/// int matrices are GF(2) matrices, other element types bring their own field arithmetic
 template <class U>
-void gaussSolve(U &&A) {
+int eliminateColumns(U &&A, int columns) {
+	using T		= std::remove_reference_t<U>::Elem;
 	auto [n, m] = A.shape();
-	NDArray B((_, m), type<int>);
-	for (int j = 0; j < std::min(n, m); ++j) {
-		bool found = false;
-		for (int i = j; i < n; ++i)
-			if (A[i][j] == 1) {		// always is one because of rank N
-				found = true;
-				if (i == j) break;
-				B	 = A[i];
-				A[i] = A[j];
-				A[j] = B;
+	Arena::Scope scratch;
+	NDArray B((_, m), type<T>, scratch.arena);
+	int		r = 0;
+	for (int j = 0; j < columns && r < n; ++j) {
+		int pivot = -1;
+		for (int i = r; i < n; ++i)
+			if (T(A[i][j]) != T{}) {
+				pivot = i;
 				break;
 			}
-		if (!found) {}
+		if (pivot < 0) continue;
+		if (pivot != r) {
+			B		 = A[pivot];
+			A[pivot] = A[r];
+			A[r]	 = B;
+		}
+
+		if constexpr (!isBinary<T>) A[r] = A[r] * FieldTraits<T>::inverse(A[r][j]);
 
 		for (int i = 0; i < n; ++i) {
-			if (i == j) continue;
-			if (A[i][j] == 1) {
-				A[i] -= A[j];
-				A[i].apply([](int x) { return x & 1; });
+			if (i == r) continue;
+			if constexpr (isBinary<T>) {
+				if (A[i][j] == 1) { A[i] = map(A[i] - A[r], mod2); }
+			} else {
+				T f = A[i][j];
+				if (f != T{}) { A[i] = A[i] - A[r] * f; }
 			}
 		}
+		++r;
+	}
+	return r;
+}
+
+/// the pivot columns of the first r rows of a matrix after eliminateColumns, the first
+/// nonzero entry of each row
+template <class U>
+std::vector<int> leadingColumns(U &&A, int r) {
+	using T = std::remove_reference_t<U>::Elem;
+	std::vector<int> res;
+	for (int i = 0, j = 0; i < r; ++i) {
+		while (T(A[i, j]) == T{})
+			++j;
+		res.push_back(j);
 	}
+	return res;
 }
 
 /// assumes [n,m] matrix and n <= m
 template <class U>
-void gaussSolveNonhomogenous(U &&A) {
+int gaussSolve(U &&A) {
+	TRACE_SCOPE("gaussSolve");
 	auto [n, m] = A.shape();
-	NDArray B((_, m), type<int>);
-	for (int j = 0; j < m-1; ++j) {
-		bool found = false;
-		for (int i = j; i < n; ++i)
-			if (A[i][j] == 1) {		// always is one because of rank N
-				found = true;
-				if (i == j) break;
-				B	 = A[i];
-				A[i] = A[j];
-				A[j] = B;
-				break;
-			}
-		if (!found) {}
-
-		for (int i = 0; i < n; ++i) {
-			if (i == j) continue;
-			if (A[i][j] == 1) {
-				A[i] -= A[j];
-				A[i].apply([](int x) { return x & 1; });
-			}
-		}
-	}
+	return eliminateColumns(A, std::min(n, m));
 }
 
+/// assumes [n,m] matrix and n <= m
+template <class U>
+int gaussSolveNonhomogenous(U &&A) {
+	return eliminateColumns(A, std::get<1>(A.shape()) - 1);
+}
 
+/// the check matrix of the code generated by G, one row per free column of G's echelon form.
+/// with the pivots in the first columns that is [-A^t | I] for G reduced to [I | A]
 template <class g>
 auto orthogonal(g &&G) {
-	using P		= std::pair<int, int>;
+	TRACE_SCOPE("orthogonal");
+	using T		= std::remove_reference_t<g>::Elem;
 	auto [n, m] = G.shape();
 
-	auto G_ = NDArray((_, n, m), type<int>);
-	assign(G_, G_.shape(), G);
-
-	gaussSolve(G_);
-
-	NDArray H = NDArray((_, m - n, m), type<int>);
-	auto	A = Slice(G_, G_.shape(), (_, P{0, n}, P{n, m}));
-	auto	B = Slice(H, H.shape(), (_, P{0, m - n}, P{0, n}));
-	assignTransposed(B, B.shape(), A);	   // -A^t
+	// packed elimination, which also copes with generators that are not of full rank
+	if constexpr (isBinary<T>) return Echelon(BitMatrix::fromND(G)).nullspace().toND();
 
-	Slice(H, H.shape(), (_, P{0, m - n}, P{n, m})) = Identity<int>(m - n);
+	auto G_ = NDArray((_, n, m), type<T>);
+	assign(G_, G_.shape(), G);
 
+	// pivots may sit in any columns, every free column f gives the row with 1 at f and
+	// -rref[i][f] at the pivot column of row i, as Echelon::nullspace does
+	int				 r		= eliminateColumns(G_, m);
+	std::vector<int> pivots = leadingColumns(G_, r);
+	std::vector<bool> isPivot(m, false);
+	for (int p : pivots)
+		isPivot[p] = true;
+
+	NDArray<T, int, int> H = Zeros((_, m - r, m), type<T>);
+	for (int f = 0, k = 0; f < m; ++f) {
+		if (isPivot[f]) continue;
+		H[k, f] = T(1);
+		for (int i = 0; i < r; ++i)
+			H[k, pivots[i]] = -T(G_[i, f]);
+		++k;
+	}
 	return H;
 }
 
 template <class g, class b>
 auto solve(g &&G, b &&B) {
+	TRACE_SCOPE("solve");
 	using P = std::pair<int, int>;
+	using T = std::remove_reference_t<g>::Elem;
 
 	auto [n, m] = G.shape();
 	auto [k]	= B.shape();
 	//std::cout << std::format("G: [{}, {}] B: [{}] \n", n, m, k) << std::endl;
 	assert(k == m);
 
-	auto G_										 = NDArray((_, m, n+1), type<int>);
-	assignTransposed(G_, (_, m, n), G);
-	assignTransposed(
-		Slice(G_, G_.shape(), (_, P{0, m}, P{n, n + 1})),
-		(_, m, 1), 
-		Repeat(B, 1, B.shape(), type<int>));
-
-	gaussSolveNonhomogenous(G_);
-
-	auto res = NDArray((_, n), type<int>);
-	for(int i = 0; i < n; ++i) {
-		res[i] = G_[i][n];
+	if constexpr (isBinary<T>) {
+		BitMatrix a(m, n + 1);
+		for (int i = 0; i < n; ++i) {
+			auto row = G[i];
+			for (int j = 0; j < m; ++j)
+				if (int(row[j]) & 1) a.set(j, i);
+		}
+		for (int j = 0; j < m; ++j)
+			if (int(B[j]) & 1) a.set(j, n);
+
+		auto x = Echelon(std::move(a)).augmentedSolution();
+		if (!x) throw std::runtime_error("word is not in the code");
+		auto res = NDArray((_, n), type<T>);
+		for (int i = 0; i < n; ++i)
+			res[i] = int(x->get(0, i));
+		return res;
 	}
 
+	// the augmented matrix [G^t | B] is the only copy, elimination works in place
+	Arena::Scope scratch;
+	auto G_ = NDArray((_, m, n + 1), type<T>, scratch.arena);
+	auto V	= stridedView(G_);
+	V.slice((_, P{0, m}, P{0, n})) = Transpose(G);
+	V.transpose()[n]			   = B;
+
+	int r = gaussSolveNonhomogenous(G_);
+	// every row without a pivot must have reduced B to zero as well
+	for (int i = r; i < m; ++i)
+		if (T(G_[i, n]) != T{}) throw std::runtime_error("word is not in the code");
+
+	// free variables are 0, the pivot of row i fixes the variable of its column
+	std::vector<int> pivots = leadingColumns(G_, r);
+	NDArray<T, int>	 res	= Zeros((_, n), type<T>);
+	for (int i = 0; i < r; ++i)
+		res[pivots[i]] = T(G_[i, n]);
+
 	return res;
 }
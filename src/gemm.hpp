@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "arena.hpp"
+
+// the SIMD kernels need the ISA enabled at compile time, e.g. with the CODE_NATIVE CMake option
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/// register tile and cache block sizes of the integer matmul kernel. An MR x KC
+/// panel of A stays in L1 and a KC x NC panel of B stays in L2 while they are reused
+struct GemmBlocking {
+	static constexpr int MR = 4;
+#if defined(__AVX512F__)
+	static constexpr int NR = 16;
+#else
+	static constexpr int NR = 8;
+#endif
+	static constexpr int MC = 64;
+	static constexpr int KC = 256;
+	static constexpr int NC = 1024;
+};
+
+/// c[MR x NR] += a * b for one packed panel pair, only the top-left mr x nr part of c is written
+inline void gemmMicroKernel(int kc, const int *a, const int *b, int *c, int ldc, int mr, int nr) {
+	constexpr int MR = GemmBlocking::MR;
+	constexpr int NR = GemmBlocking::NR;
+	alignas(64) int acc[MR][NR];
+#if defined(__AVX512F__)
+	__m512i sum[MR];
+	for (int i = 0; i < MR; ++i)
+		sum[i] = _mm512_setzero_si512();
+	for (int p = 0; p < kc; ++p) {
+		__m512i bv = _mm512_loadu_si512(b + p * NR);
+		for (int i = 0; i < MR; ++i)
+			sum[i] = _mm512_add_epi32(sum[i], _mm512_mullo_epi32(_mm512_set1_epi32(a[p * MR + i]), bv));
+	}
+	for (int i = 0; i < MR; ++i)
+		_mm512_store_si512(acc[i], sum[i]);
+#elif defined(__AVX2__)
+	__m256i sum[MR];
+	for (int i = 0; i < MR; ++i)
+		sum[i] = _mm256_setzero_si256();
+	for (int p = 0; p < kc; ++p) {
+		__m256i bv = _mm256_loadu_si256((const __m256i *)(b + p * NR));
+		for (int i = 0; i < MR; ++i)
+			sum[i] = _mm256_add_epi32(sum[i], _mm256_mullo_epi32(_mm256_set1_epi32(a[p * MR + i]), bv));
+	}
+	for (int i = 0; i < MR; ++i)
+		_mm256_store_si256((__m256i *)acc[i], sum[i]);
+#else
+	for (int i = 0; i < MR; ++i)
+		for (int j = 0; j < NR; ++j)
+			acc[i][j] = 0;
+	for (int p = 0; p < kc; ++p)
+		for (int i = 0; i < MR; ++i)
+			for (int j = 0; j < NR; ++j)
+				acc[i][j] += a[p * MR + i] * b[p * NR + j];
+#endif
+	for (int i = 0; i < mr; ++i)
+		for (int j = 0; j < nr; ++j)
+			c[i * ldc + j] += acc[i][j];
+}
+
+/// copies the kc x nc block of b into NR wide column strips, zero padded
+inline void gemmPackB(int kc, int nc, const int *b, int ldb, int *packed) {
+	constexpr int NR = GemmBlocking::NR;
+	for (int j = 0; j < nc; j += NR) {
+		int nr = std::min(NR, nc - j);
+		for (int p = 0; p < kc; ++p) {
+			for (int jj = 0; jj < nr; ++jj)
+				packed[p * NR + jj] = b[p * ldb + j + jj];
+			for (int jj = nr; jj < NR; ++jj)
+				packed[p * NR + jj] = 0;
+		}
+		packed += kc * NR;
+	}
+}
+
+/// copies the mc x kc block of a into MR high row strips, zero padded
+inline void gemmPackA(int mc, int kc, const int *a, int lda, int *packed) {
+	constexpr int MR = GemmBlocking::MR;
+	for (int i = 0; i < mc; i += MR) {
+		int mr = std::min(MR, mc - i);
+		for (int p = 0; p < kc; ++p) {
+			for (int ii = 0; ii < mr; ++ii)
+				packed[p * MR + ii] = a[(i + ii) * lda + p];
+			for (int ii = mr; ii < MR; ++ii)
+				packed[p * MR + ii] = 0;
+		}
+		packed += kc * MR;
+	}
+}
+
+/// c[n x k] += a[n x m] * b[m x k] for row-major int matrices with leading dimensions lda, ldb, ldc
+inline void gemm(int n, int m, int k, const int *a, int lda, const int *b, int ldb, int *c, int ldc) {
+	constexpr int MR = GemmBlocking::MR;
+	constexpr int NR = GemmBlocking::NR;
+	constexpr int MC = GemmBlocking::MC;
+	constexpr int KC = GemmBlocking::KC;
+	constexpr int NC = GemmBlocking::NC;
+
+	Arena::Scope scratch;
+	int			*packedA = scratch.arena.allocate<int>(MC * KC);
+	int			*packedB = scratch.arena.allocate<int>(KC * (NC + NR));
+
+	for (int jc = 0; jc < k; jc += NC) {
+		int nc = std::min(NC, k - jc);
+		for (int pc = 0; pc < m; pc += KC) {
+			int kc = std::min(KC, m - pc);
+			gemmPackB(kc, nc, b + pc * ldb + jc, ldb, packedB);
+			for (int ic = 0; ic < n; ic += MC) {
+				int mc = std::min(MC, n - ic);
+				gemmPackA(mc, kc, a + ic * lda + pc, lda, packedA);
+				for (int jr = 0; jr < nc; jr += NR) {
+					for (int ir = 0; ir < mc; ir += MR) {
+						gemmMicroKernel(kc, packedA + ir * kc, packedB + jr * kc, c + (ic + ir) * ldc + jc + jr, ldc,
+										std::min(MR, mc - ir), std::min(NR, nc - jr));
+					}
+				}
+			}
+		}
+	}
+}
+
+/// same as gemm, with the rows of c split between threads. threads <= 0 picks one per core
+/// for products that are large enough to be worth it
+inline void gemmParallel(int n, int m, int k, const int *a, int lda, const int *b, int ldb, int *c, int ldc,
+						 int threads = 0) {
+	if (threads <= 0) {
+		bool large = std::size_t(n) * m * k >= (std::size_t(1) << 24);
+		threads	   = large ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+	}
+	threads = std::min(threads, (n + GemmBlocking::MC - 1) / GemmBlocking::MC);
+	if (threads <= 1) return gemm(n, m, k, a, lda, b, ldb, c, ldc);
+
+	std::vector<std::thread> workers;
+	int						 rows = (n + threads - 1) / threads;
+	for (int t = 0; t < threads; ++t) {
+		int begin = t * rows;
+		int end	  = std::min(n, begin + rows);
+		if (begin >= end) break;
+		workers.emplace_back([=] { gemm(end - begin, m, k, a + begin * lda, lda, b, ldb, c + begin * ldc, ldc); });
+	}
+	for (auto &w : workers)
+		w.join();
+}
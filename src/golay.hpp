@@ -1,9 +1,11 @@
 #pragma once
 #include "autoref.hpp"
+#include "bitmatrix.hpp"
 #include "hadamard.hpp"
 #include "ndarray.hpp"
 #include "primitives.hpp"
 #include "slice.hpp"
+#include "trace.hpp"
 
 inline auto Golay24() {
 	using P = std::pair<int, int>;
@@ -28,6 +30,10 @@ inline auto Golay24() {
 
 template<class V>
 inline bool isSelfOrthogonal(V && v) {
+	if constexpr (isBinary<typename std::remove_reference_t<V>::Elem>) {
+		BitMatrix g = BitMatrix::fromND(v);
+		return (g * g.transposed()).isZero();
+	}
 	for(int i = 0; i < std::get<0>(v.shape()); ++i) {
 		if(!isSolution(v[i], v)) {
 			return false;
@@ -36,9 +42,9 @@ inline bool isSelfOrthogonal(V && v) {
 	return true;
 }
 
+/// digits of n in the given base, least significant first
 template<class Arr>
-inline auto numToBoolVec(int n, Arr& arr) {
-	const int base = 2;
+inline auto numToVec(int n, Arr& arr, int base) {
 	auto [len] = arr.shape();
 	for(int i = 0; i < len; ++i) {
 		arr[i] = n % base;
@@ -46,6 +52,11 @@ inline auto numToBoolVec(int n, Arr& arr) {
 	}
 }
 
+template<class Arr>
+inline auto numToBoolVec(int n, Arr& arr) {
+	numToVec(n, arr, 2);
+}
+
 inline auto pow(int n, int k) {
 	int res = 1;
 	for(int i = 0; i < k; ++i) res *= n;
@@ -54,19 +65,22 @@ inline auto pow(int n, int k) {
 
 template<class G>
 inline int findDistance(G && g) {
+	TRACE_SCOPE("findDistance");
+
+	using T = std::remove_reference_t<G>::Elem;
+	constexpr int q = FieldTraits<T>::q;
 
 	auto [k, n] = g.shape();
-	int K = pow(2, k);
-	auto coefs = Zeros((_, k), type<int>);
+	int K = pow(q, k);
+	Arena::Scope scratch;
+	auto coefs = Zeros((_, k), type<T>, scratch.arena);
 		
-	int min = k;
+	int min = n;
 
 	for(int i = 0; i < K; ++i) {
-		numToBoolVec(i, coefs);
-		int weight = w(
-			vecMatMul(coefs, g).apply([](int x) {return x % 2;})
-			//.print(std::cout)
-		);
+		Arena::Scope iteration(scratch.arena);
+		numToVec(i, coefs, q);
+		int weight = w(map(vecMatMul(coefs, g, scratch.arena), FieldTraits<T>::reduce));
 		if(weight != 0) min = std::min(min, weight);
 	}
 	return min;
@@ -1,58 +1,212 @@
 #pragma once
 
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
 #include <ndarray.hpp>
 #include <primitives.hpp>
 #include <slice.hpp>
 #include <prime.hpp>
+#include "bitmatrix.hpp"
+#include "parallel.hpp"
+
+/// the Sylvester Hadamard matrix of order n = 2^m computed entry by entry, (i, j) is
+/// (-1)^popcount(i & j). Nothing of size n^2 is ever stored
+class SylvesterHadamard {
+	int n;
+
+	/// bits b of one 64-column word with popcount(a & b) even
+	static uint64_t pattern(int a) {
+		static constexpr uint64_t columnBit[6] = {0xaaaaaaaaaaaaaaaa, 0xcccccccccccccccc, 0xf0f0f0f0f0f0f0f0,
+												  0xff00ff00ff00ff00, 0xffff0000ffff0000, 0xffffffff00000000};
+		uint64_t res = ~uint64_t(0);
+		for (int k = 0; k < 6; ++k)
+			if (a >> k & 1) res ^= columnBit[k];
+		return res;
+	}
+
+   public:
+	explicit SylvesterHadamard(int n) : n(n) {
+		if (!isPowerOfTwo(n)) throw std::runtime_error("Sylvester order must be a power of two");
+	}
+
+	int size() const { return n; }
+	bool positive(int i, int j) const { return (std::popcount(unsigned(i & j)) & 1) == 0; }
+	int operator()(int i, int j) const { return positive(i, j) ? 1 : -1; }
 
-inline auto hadamardPaley(int n) {
-	using P = std::pair<int, int>;
+	/// row i packed into BitMatrix::wordsFor(n) words, bit j set where the entry is +1.
+	/// Every word is the pattern of the low six bits of i, inverted by the parity of the rest
+	void row(int i, uint64_t *out) const {
+		uint64_t low   = pattern(i & 63);
+		int		 words = BitMatrix::wordsFor(n);
+		for (int w = 0; w < words; ++w)
+			out[w] = std::popcount(unsigned(i >> 6 & w)) & 1 ? ~low : low;
+		if (n < 64) out[0] &= (uint64_t(1) << n) - 1;
+	}
+};
 
-	int p = n-1;
-	assert(isPrime(p) && p % 4 == 3);
-	NDArray a = Ones((_, p), type<int>);
-	-a;
+/// the Paley Hadamard matrix of order n computed entry by entry from a bitmap of the
+/// quadratic residues mod p. Type I needs p = n - 1 prime with p = 3 mod 4, type II
+/// p = n / 2 - 1 prime with p = 1 mod 4; type I is used when both apply
+class PaleyHadamard {
+	int n, p;
+	bool second;
+	/// bit k is set when (k - 1) mod p is a nonzero square, for k in [0, 2p]. Row a of the
+	/// Jacobsthal matrix starts at bit p - a, so rotating a row is one shifted word copy
+	std::vector<uint64_t> residues;
 
-	a[0] = 0;
-	for(int i = 1; i < p; ++i) {
-		a[(i * i) % p] = 1;
+	bool residue(int x) const {
+		int k = x + 1;
+		return residues[k / 64] >> (k % 64) & 1;
 	}
-	//a.print(std::cout);
-	
-	auto rep = Cycle(a, a.shape());
-	NDArray A = Ones((_, n,n), type<int>);
 
-	auto Q = Slice(A, A.shape(), (_, P{1,n}, P{1, n}));
-	for(int i = 0; i < p; ++i) {
-		for(int j = 0; j < p; ++j) {
-			Q[i][j] = rep[j - i];
+	/// bit 0 set, bit 1 + b set when b - a is a nonzero square mod p, for b in [0, p)
+	void jacobsthalRow(int a, uint64_t *out) const {
+		int from  = p - a;
+		int words = BitMatrix::wordsFor(p + 1);
+		for (int w = 0; w < words; ++w) {
+			int		 bit   = from + w * 64;
+			int		 shift = bit % 64;
+			uint64_t word  = residues[bit / 64] >> shift;
+			if (shift) word |= residues[bit / 64 + 1] << (64 - shift);
+			out[w] = word;
 		}
+		out[0] |= 1;
+		if ((p + 1) % 64) out[words - 1] &= (uint64_t(1) << ((p + 1) % 64)) - 1;
 	}
-	Q -= Identity<int>(p);
-	return A;
+
+	/// the low 32 bits of x moved to the even bits
+	static uint64_t spread(uint64_t x) {
+		x &= 0xffffffff;
+		x = (x | x << 16) & 0x0000ffff0000ffff;
+		x = (x | x << 8) & 0x00ff00ff00ff00ff;
+		x = (x | x << 4) & 0x0f0f0f0f0f0f0f0f;
+		x = (x | x << 2) & 0x3333333333333333;
+		return (x | x << 1) & 0x5555555555555555;
+	}
+
+	/// entry (r, c) of the conference matrix [0 1; 1 Q] of order p + 1, zero on the diagonal
+	int conference(int r, int c) const {
+		if (r == c) return 0;
+		if (r == 0 || c == 0) return 1;
+		return residue((c - r + p) % p) ? 1 : -1;
+	}
+
+   public:
+	explicit PaleyHadamard(int n) : n(n) {
+		if (isPrime(n - 1) && (n - 1) % 4 == 3) {
+			p	   = n - 1;
+			second = false;
+		} else if (n % 4 == 0 && isPrime(n / 2 - 1) && (n / 2 - 1) % 4 == 1) {
+			p	   = n / 2 - 1;
+			second = true;
+		} else throw std::runtime_error("no Paley construction of order " + std::to_string(n));
+
+		residues.assign(BitMatrix::wordsFor(2 * p + 1) + 1, 0);
+		std::vector<bool> square(p);
+		for (long x = 1; x < p; ++x)
+			square[x * x % p] = true;
+		for (int k = 0; k <= 2 * p; ++k)
+			if (square[(k - 1 + p) % p]) residues[k / 64] |= uint64_t(1) << (k % 64);
+	}
+
+	int size() const { return n; }
+	/// true for the type II construction from a conference matrix
+	bool secondKind() const { return second; }
+
+	int operator()(int i, int j) const {
+		if (!second) {
+			if (i == 0 || j == 0) return 1;
+			return i == j ? -1 : conference(i, j);
+		}
+		// C (x) [1 1; 1 -1] + I (x) [1 -1; -1 -1]
+		int r = i / 2, c = j / 2;
+		bool both = i & j & 1;
+		if (r == c) return i % 2 == 0 && j % 2 == 0 ? 1 : -1;
+		return both ? -conference(r, c) : conference(r, c);
+	}
+	bool positive(int i, int j) const { return (*this)(i, j) > 0; }
+
+	/// row i packed into BitMatrix::wordsFor(n) words, bit j set where the entry is +1
+	void row(int i, uint64_t *out) const {
+		int words = BitMatrix::wordsFor(n);
+		if (!second) {
+			if (i == 0) std::fill(out, out + words, ~uint64_t(0));
+			else jacobsthalRow(i - 1, out);	   // the diagonal bit is already clear
+			if (n % 64) out[words - 1] &= (uint64_t(1) << (n % 64)) - 1;
+			return;
+		}
+
+		int					  r = i / 2, q = p + 1;
+		int					  confWords = BitMatrix::wordsFor(q);
+		std::vector<uint64_t> plus(confWords), minus(confWords);
+		if (r == 0) {
+			std::fill(plus.begin(), plus.end(), ~uint64_t(0));
+			plus[0] &= ~uint64_t(1);
+		} else jacobsthalRow(r - 1, plus.data());
+		for (int w = 0; w < confWords; ++w)
+			minus[w] = ~plus[w];
+		minus[r / 64] &= ~(uint64_t(1) << (r % 64));
+		if (q % 64) {
+			plus[confWords - 1] &= (uint64_t(1) << (q % 64)) - 1;
+			minus[confWords - 1] &= (uint64_t(1) << (q % 64)) - 1;
+		}
+
+		// column pair (2c, 2c + 1) is (C, C) in an even row and (C, -C) in an odd one
+		for (int w = 0; w < words; ++w) {
+			uint64_t even = spread(plus[w / 2] >> (w % 2 * 32));
+			uint64_t odd  = i % 2 ? spread(minus[w / 2] >> (w % 2 * 32)) : even;
+			out[w]		  = even | odd << 1;
+		}
+		uint64_t pair = uint64_t(3) << (2 * r % 64);
+		out[2 * r / 64] &= ~pair;
+		if (i % 2 == 0) out[2 * r / 64] |= uint64_t(1) << (2 * r % 64);
+		if (n % 64) out[words - 1] &= (uint64_t(1) << (n % 64)) - 1;
+	}
+};
+
+/// packs an implicit Hadamard matrix with bit (i, j) set where the entry is +1, as
+/// matrixToCode does. Rows do not depend on each other and are filled in parallel blocks
+template <class H>
+BitMatrix packHadamard(const H &h) {
+	TRACE_SCOPE("packHadamard");
+	BitMatrix res(h.size(), h.size());
+	parallelFor(0, h.size(), 64, [&](int b, int e) {
+		for (int i = b; i < e; ++i)
+			h.row(i, res.row(i));
+	});
+	return res;
 }
 
-inline Ones<int, int, int> hadamardSylvester(int n) {
-	if(n == 1) return Ones((_, 1, 1), type<int>);
-
-	assert(isPowerOfTwo(n) && "power of two needed");
-	
-	using P = std::pair<int, int>;
-	auto A = Ones((_, n, n), type<int>);
-	
-	auto B = hadamardSylvester(n / 2);
-	//auto _B = Cycle(B, B.shape());
-	//A.apply2([](int, int y) { return y; }, _B);
-	//assign(A, A.shape(), _B);
-	A.assign(Cycle(B, B.shape()));
-	-Slice(A, A.shape(), (_, P{n / 2, n}, P{n / 2, n}));
+inline BitMatrix packedSylvester(int n) { return packHadamard(SylvesterHadamard(n)); }
+inline BitMatrix packedPaley(int n) { return packHadamard(PaleyHadamard(n)); }
 
+/// copies an implicit Hadamard matrix into an ND array of +-1
+template <class H>
+inline auto hadamardArray(const H &h) {
+	int		n = h.size();
+	auto	A = Ones((_, n, n), type<int>);
+	std::vector<uint64_t> bits(BitMatrix::wordsFor(n));
+	for (int i = 0; i < n; ++i) {
+		h.row(i, bits.data());
+		auto row = A[i];
+		for (int j = 0; j < n; ++j)
+			if (!(bits[j / 64] >> (j % 64) & 1)) row[j] = -1;
+	}
 	return A;
 }
 
+inline Ones<int, int, int> hadamardPaley(int n) {
+	return hadamardArray(PaleyHadamard(n));
+}
+
+inline Ones<int, int, int> hadamardSylvester(int n) {
+	return hadamardArray(SylvesterHadamard(n));
+}
+
 template<class T>
 inline auto matrixToCode(T& A) {
 	A.apply([](int x) {return x > 0;});
 }
-
-
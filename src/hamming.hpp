@@ -0,0 +1,239 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "bitmatrix.hpp"
+#include "code.hpp"
+#include "ndarray.hpp"
+#include "primitives.hpp"
+
+/// binary Hamming code with r check bits, optionally shortened and extended by an overall
+/// parity bit. The columns of the check matrix are laid out so the syndrome names the error
+/// position: positions 0 .. V - 1 have the columns 1 .. V, then come the powers of two
+/// above V. A shortened code drops the largest columns that are not powers of two. The
+/// check bits sit at the powers of two, the message fills the other positions in order, and
+/// the extended code appends the overall parity as its last position.
+/// Decoding is one syndrome, one bit flip and a gather of the message, without tables
+class HammingCode {
+	int	 r;
+	int	 m;		// length without the parity bit
+	int	 v;		// positions 0 .. v - 1 have the columns 1 .. v
+	bool extended;
+	bool systematic = true;	   // whether a code found by fromLinearCode has the messages of its generator
+
+	static int widthOf(int x) { return std::bit_width(unsigned(x)); }
+
+	static uint64_t mask(int bits) { return bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1; }
+
+	static bool bit(const uint64_t *w, int j) { return w[j / 64] >> (j % 64) & 1; }
+	static void flip(uint64_t *w, int j) { w[j / 64] ^= uint64_t(1) << (j % 64); }
+
+	/// dst bits [at, at + count) |= src bits [from, from + count)
+	static void copyBits(uint64_t *dst, int at, const uint64_t *src, int from, int count) {
+		for (int done = 0; done < count; done += 64) {
+			int		 s = from + done, d = at + done, len = std::min(64, count - done);
+			uint64_t x = src[s / 64] >> (s % 64);
+			if (s % 64 && s % 64 + len > 64) x |= src[s / 64 + 1] << (64 - s % 64);
+			x &= mask(len);
+			dst[d / 64] |= x << (d % 64);
+			if (d % 64 && d % 64 + len > 64) dst[d / 64 + 1] |= x >> (64 - d % 64);
+		}
+	}
+
+	/// the message runs: the positions 2^b .. min(2^(b+1) - 1, v) - 1 between two check bits,
+	/// for b = 1, 2, ... They start at bit 2^b - b - 1 of the message
+	template <class F>
+	void forEachRun(F &&f) const {
+		for (int b = 1; (1 << b) < v; ++b)
+			f(1 << b, (1 << b) - b - 1, std::min((1 << (b + 1)) - 1, v) - (1 << b));
+	}
+
+   public:
+	/// the Hamming code of length 2^r - 1 with its shortened first positions removed
+	HammingCode(int r, int shortened = 0, bool extended = false) : r(r), m((1 << r) - 1 - shortened), extended(extended) {
+		if (r < 2 || r > 30) throw std::runtime_error("Hamming codes need 2 to 30 check bits");
+		if (shortened < 0 || m < r + 1) throw std::runtime_error("Hamming code shortened below one message bit");
+		// v + (number of powers of two above v) = m, unchanged when v reaches a power of two
+		for (v = m - r; v + r - widthOf(v) != m;)
+			++v;
+	}
+
+	/// the code as a Hamming code in this layout if it is one: every row of its generator has a
+	/// zero syndrome (and even weight for the extended code) and the dimensions match
+	static std::optional<HammingCode> fromLinearCode(LinearCode &code) {
+		int n = code.length(), k = code.blockLength();
+		for (bool ext : {false, true}) {
+			int m = n - ext, r = n - k - ext;
+			if (r < 2 || r > 30 || m > (1 << r) - 1 || m < r + 1) continue;
+			HammingCode		 h(r, (1 << r) - 1 - m, ext);
+			const BitMatrix &G = code.packedGenerator();
+			bool			 in = true;
+			for (int i = 0; i < k && in; ++i)
+				in = h.sindrome(G.row(i)) == 0 && (!ext || G.rowWeight(i) % 2 == 0);
+			if (!in) continue;
+
+			std::vector<uint64_t> message(BitMatrix::wordsFor(k));
+			for (int i = 0; i < k && h.systematic; ++i) {
+				h.message(G.row(i), message.data());
+				for (int w = 0; w < int(message.size()); ++w)
+					h.systematic &= message[w] == (w == i / 64 ? uint64_t(1) << (i % 64) : 0);
+			}
+			return h;
+		}
+		return std::nullopt;
+	}
+
+	int	 length() const { return m + extended; }
+	int	 blockLength() const { return m - r; }
+	int	 redundancy() const { return r + extended; }
+	bool isExtended() const { return extended; }
+	/// whether message() gives the message the generator of the code it was found in encodes
+	bool isSystematic() const { return systematic; }
+
+	/// the check matrix column of position j < length without the parity bit
+	uint64_t column(int j) const { return j < v ? uint64_t(j) + 1 : uint64_t(1) << (widthOf(v) + j - v); }
+	/// the position with column s, -1 when no position has it
+	int position(uint64_t s) const {
+		if (s == 0 || s >= (uint64_t(1) << r)) return -1;
+		if (s <= uint64_t(v)) return int(s) - 1;
+		if (!std::has_single_bit(s)) return -1;
+		return v + std::countr_zero(s) - widthOf(v);
+	}
+
+	/// syndrome of the first m bits of a packed word, the parity bit is not included. Position j
+	/// has column j + 1, so within a word of j + 1 the low six bits of the column are fixed
+	/// patterns and the others are the word index
+	uint64_t sindrome(const uint64_t *word) const {
+		static constexpr uint64_t columnBit[6] = {0xaaaaaaaaaaaaaaaa, 0xcccccccccccccccc, 0xf0f0f0f0f0f0f0f0,
+												  0xff00ff00ff00ff00, 0xffff0000ffff0000, 0xffffffff00000000};
+		uint64_t s = 0;
+		for (int w = 0; w <= v / 64; ++w) {
+			// bits x = j + 1 in [64w, 64w + 64) of the word shifted up by one
+			uint64_t x = w < BitMatrix::wordsFor(v) ? word[w] << 1 : 0;
+			if (w > 0) x |= word[w - 1] >> 63;
+			if (w == v / 64) x &= mask(v % 64 + 1);
+			for (int b = 0; b < 6; ++b)
+				s ^= uint64_t(std::popcount(x & columnBit[b]) & 1) << b;
+			if (std::popcount(x) & 1) s ^= uint64_t(w) << 6;
+		}
+		for (int j = v; j < m; ++j)
+			if (bit(word, j)) s ^= column(j);
+		return s;
+	}
+
+	/// corrects one error of a packed word in place, false when the syndrome shows more:
+	/// a column no position has, or an even number of errors in the extended code
+	bool correct(uint64_t *word) const {
+		uint64_t s = sindrome(word);
+		if (extended) {
+			int parity = 0;
+			for (int w = 0; w < BitMatrix::wordsFor(m + 1); ++w)
+				parity ^= std::popcount(w == m / 64 ? word[w] & mask(m % 64 + 1) : word[w]) & 1;
+			if (!parity) return s == 0;
+			if (s == 0) {
+				flip(word, m);
+				return true;
+			}
+		}
+		if (s == 0) return true;
+		int j = position(s);
+		if (j < 0) return false;
+		flip(word, j);
+		return true;
+	}
+
+	/// gathers the message bits of a packed codeword into message, which is cleared first
+	void message(const uint64_t *word, uint64_t *message) const {
+		std::fill(message, message + BitMatrix::wordsFor(blockLength()), 0);
+		forEachRun([&](int from, int at, int count) { copyBits(message, at, word, from, count); });
+	}
+
+	/// packed codeword of a packed message
+	void encode(const uint64_t *message, uint64_t *word) const {
+		std::fill(word, word + BitMatrix::wordsFor(length()), 0);
+		forEachRun([&](int to, int from, int count) { copyBits(word, to, message, from, count); });
+		for (uint64_t s = sindrome(word); s; s &= s - 1)
+			flip(word, position(s & -s));
+		if (extended) {
+			int parity = 0;
+			for (int w = 0; w < BitMatrix::wordsFor(m); ++w)
+				parity ^= std::popcount(word[w]) & 1;
+			if (parity) flip(word, m);
+		}
+	}
+
+	template <class Arr>
+	static std::vector<uint64_t> pack(Arr &&word) {
+		auto [len] = word.shape();
+		std::vector<uint64_t> res(BitMatrix::wordsFor(len));
+		for (int j = 0; j < len; ++j)
+			if (int(word[j]) & 1) res[j / 64] |= uint64_t(1) << (j % 64);
+		return res;
+	}
+	template <class Arr>
+	static void unpack(const uint64_t *bits, Arr &&word) {
+		auto [len] = word.shape();
+		for (int j = 0; j < len; ++j)
+			word[j] = int(bit(bits, j));
+	}
+
+	/// codeword of a message of length k, allocated from arena when one is given
+	template <NDLike Arr, class... Alloc>
+	NDArray<int, int> encode(Arr &&message, Alloc &...arena) const {
+		NDArray<int, int>	  res = Zeros((_, length()), type<int>, arena...);
+		std::vector<uint64_t> word(BitMatrix::wordsFor(length()));
+		encode(pack(message).data(), word.data());
+		unpack(word.data(), res);
+		return res;
+	}
+
+	/// corrects a received word in place, false if it has more errors than the decoder can find
+	template <NDLike Arr>
+	bool correct(Arr &&word) const {
+		auto bits = pack(word);
+		if (!correct(bits.data())) return false;
+		unpack(bits.data(), word);
+		return true;
+	}
+
+	/// the message bits of a codeword
+	template <NDLike Arr>
+	NDArray<int, int> message(Arr &&word) const {
+		NDArray<int, int>	  res = Zeros((_, blockLength()), type<int>);
+		std::vector<uint64_t> bits(BitMatrix::wordsFor(blockLength()));
+		message(pack(word).data(), bits.data());
+		unpack(bits.data(), res);
+		return res;
+	}
+
+	/// the codewords of the unit messages as the rows of a k x n generator matrix
+	NDArray<int, int, int> generatorMatrix() const {
+		int					   k = blockLength();
+		NDArray<int, int, int> G = Zeros((_, k, length()), type<int>);
+		std::vector<uint64_t>  message(BitMatrix::wordsFor(k)), word(BitMatrix::wordsFor(length()));
+		for (int i = 0; i < k; ++i) {
+			std::fill(message.begin(), message.end(), 0);
+			message[i / 64] = uint64_t(1) << (i % 64);
+			encode(message.data(), word.data());
+			unpack(word.data(), G[i]);
+		}
+		return G;
+	}
+
+	/// bit b of the columns as row b, and a row of ones for the parity of the extended code
+	NDArray<int, int, int> checkMatrix() const {
+		NDArray<int, int, int> H = Zeros((_, redundancy(), length()), type<int>);
+		for (int j = 0; j < m; ++j)
+			for (int b = 0; b < r; ++b)
+				H[b][j] = int(column(j) >> b & 1);
+		if (extended)
+			for (int j = 0; j < length(); ++j)
+				H[r][j] = 1;
+		return H;
+	}
+};
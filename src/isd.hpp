@@ -0,0 +1,279 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "bitmatrix.hpp"
+#include "code.hpp"
+#include "gauss.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+
+enum class IsdVariant { Prange, LeeBrickell, Stern };
+
+struct IsdOptions {
+	IsdVariant variant = IsdVariant::Stern;
+	/// errors of at most this weight end the search, -1 takes the Gilbert-Varshamov radius of the code
+	int weight = -1;
+	/// columns outside the information set taken by Lee-Brickell, or from each half by Stern
+	int p = 2;
+	/// number of syndrome bits Stern's halves have to agree on, at most 64
+	int l = 16;
+	/// information sets tried over all threads, and a wall clock limit (0 is none) for one word
+	long					  iterations = 1 << 18;
+	std::chrono::milliseconds timeLimit{0};
+	/// 0 is one thread per core
+	int		 threads = 0;
+	uint64_t seed	 = 0x5eed;
+};
+
+/// information set decoding for binary codes too large for a syndrome table. Each thread
+/// walks through random information sets of the parity check matrix, one column swap at a
+/// time so the previous pivots are reused, and looks for a low weight error in each. The
+/// lightest error found is kept until one within the target weight shows up or the budget is spent
+class IsdDecoder {
+	LinearCode &code;
+	IsdOptions	options;
+
+	/// column-major [H | s] of one walk, with r pivot columns forming an identity
+	class Walk {
+		BitMatrix		 cols;	  // row x is column x of [H | s], row n is the syndrome
+		int				 n, r, words;
+		std::vector<int> pivotOf;	  // pivot column of every row
+		std::vector<int> nonPivot;	  // the k columns of the information set
+		std::vector<int> position;	  // index in nonPivot, -1 for pivot columns
+		std::vector<uint64_t> mask;
+
+		/// eliminates column c with row i: every row with a one in column c gets row i added
+		void pivot(int i, int c) {
+			std::copy_n(cols.row(c), words, mask.begin());
+			mask[i / 64] &= ~(uint64_t(1) << (i % 64));
+			for (int x = 0; x <= n; ++x) {
+				if (!cols.get(x, i)) continue;
+				uint64_t *dst = cols.row(x);
+				for (int w = 0; w < words; ++w)
+					dst[w] ^= mask[w];
+			}
+		}
+
+	   public:
+		Walk(const BitMatrix &checkT, const BitMatrix &sindrome, std::mt19937_64 &rng)
+			: cols(checkT.rows() + 1, checkT.cols()), n(checkT.rows()), r(checkT.cols()), words(cols.words()),
+			  pivotOf(r, -1), position(n, -1), mask(words) {
+			for (int x = 0; x < n; ++x)
+				std::copy_n(checkT.row(x), words, cols.row(x));
+			std::copy_n(sindrome.row(0), words, cols.row(n));
+
+			std::vector<int> order(n);
+			std::iota(order.begin(), order.end(), 0);
+			std::shuffle(order.begin(), order.end(), rng);
+			std::vector<uint64_t> pivoted(words, 0);
+			int					  found = 0;
+			for (int c : order) {
+				int i = -1;
+				for (int w = 0; w < words && i < 0; ++w)
+					if (uint64_t free = cols.row(c)[w] & ~pivoted[w]) i = w * 64 + std::countr_zero(free);
+				if (i < 0) {
+					position[c] = nonPivot.size();
+					nonPivot.push_back(c);
+					continue;
+				}
+				pivot(i, c);
+				pivoted[i / 64] |= uint64_t(1) << (i % 64);
+				pivotOf[i] = c;
+				++found;
+			}
+			if (found < r) throw std::runtime_error("check matrix does not have full rank");
+		}
+
+		/// replaces one pivot column by a random information set column that can take its row
+		void swap(std::mt19937_64 &rng) {
+			int i = rng() % r;
+			for (int tries = 0; tries < 4 * int(nonPivot.size()); ++tries) {
+				int c = nonPivot[rng() % nonPivot.size()];
+				if (!cols.get(c, i)) continue;
+				pivot(i, c);
+				int old			  = pivotOf[i];
+				pivotOf[i]		  = c;
+				nonPivot[position[c]] = old;
+				position[old]	  = position[c];
+				position[c]		  = -1;
+				return;
+			}
+		}
+
+		/// calls f(idx, sum) for every p-subset of nonPivot[begin, end) with the sum of its columns
+		template <class F>
+		void forEachSubset(int begin, int end, int p, F &&f) {
+			std::vector<int>	  idx(p);
+			std::vector<uint64_t> sums(std::size_t(p + 1) * words, 0);
+			auto				  rec = [&](auto &self, int depth, int from) -> void {
+				 if (depth == p) return f(idx.data(), sums.data() + std::size_t(p) * words);
+				 for (int j = from; j < end; ++j) {
+					 idx[depth]			 = nonPivot[j];
+					 const uint64_t *col = cols.row(nonPivot[j]);
+					 const uint64_t *prv = sums.data() + std::size_t(depth) * words;
+					 uint64_t		*nxt = sums.data() + std::size_t(depth + 1) * words;
+					 for (int w = 0; w < words; ++w)
+						 nxt[w] = prv[w] ^ col[w];
+					 self(self, depth + 1, j + 1);
+				 }
+			};
+			rec(rec, 0, begin);
+		}
+
+		int weight(const uint64_t *v, const uint64_t *a = nullptr, const uint64_t *b = nullptr) const {
+			int res = 0;
+			for (int w = 0; w < words; ++w)
+				res += std::popcount(v[w] ^ (a ? a[w] : 0) ^ (b ? b[w] : 0));
+			return res;
+		}
+
+		/// the error made of the rows set in s + a + b and the extra columns
+		std::vector<int> support(const uint64_t *a, const uint64_t *b, std::vector<int> extra) const {
+			const uint64_t *s = cols.row(n);
+			for (int i = 0; i < r; ++i) {
+				uint64_t bit = uint64_t(1) << (i % 64);
+				uint64_t v	 = s[i / 64] ^ (a ? a[i / 64] : 0) ^ (b ? b[i / 64] : 0);
+				if (v & bit) extra.push_back(pivotOf[i]);
+			}
+			return extra;
+		}
+
+		/// looks for an error lighter than limit in the current information set, its support goes to out
+		int search(const IsdOptions &options, int limit, std::vector<int> &out) {
+			const uint64_t *s	 = cols.row(n);
+			int				best = limit;
+			int				k	 = nonPivot.size();
+
+			if (int w = weight(s); w < best) {
+				best = w;
+				out	 = support(nullptr, nullptr, {});
+			}
+			if (options.variant == IsdVariant::LeeBrickell) {
+				for (int q = 1; q <= options.p; ++q)
+					forEachSubset(0, k, q, [&](const int *idx, const uint64_t *sum) {
+						if (int w = weight(s, sum) + q; w < best) {
+							best = w;
+							out	 = support(sum, nullptr, std::vector<int>(idx, idx + q));
+						}
+					});
+			} else if (options.variant == IsdVariant::Stern) {
+				// collisions on the low l syndrome bits between subsets of the two halves
+				uint64_t window = options.l >= 64 ? ~uint64_t(0) : (uint64_t(1) << std::min(options.l, r)) - 1;
+				int		 p		= options.p;
+				std::vector<std::pair<uint64_t, int>> left;
+				std::vector<int>					  subsets;
+				forEachSubset(0, k / 2, p, [&](const int *idx, const uint64_t *sum) {
+					left.emplace_back((s[0] ^ sum[0]) & window, subsets.size());
+					subsets.insert(subsets.end(), idx, idx + p);
+				});
+				std::sort(left.begin(), left.end());
+
+				std::vector<uint64_t> sumX(words);
+				forEachSubset(k / 2, k, p, [&](const int *idx, const uint64_t *sumY) {
+					auto it = std::lower_bound(left.begin(), left.end(), std::pair{sumY[0] & window, 0});
+					for (; it != left.end() && it->first == (sumY[0] & window); ++it) {
+						std::fill(sumX.begin(), sumX.end(), 0);
+						for (int j = 0; j < p; ++j) {
+							const uint64_t *col = cols.row(subsets[it->second + j]);
+							for (int w = 0; w < words; ++w)
+								sumX[w] ^= col[w];
+						}
+						if (int w = weight(s, sumX.data(), sumY) + 2 * p; w < best) {
+							best = w;
+							out	 = support(sumX.data(), sumY, std::vector<int>(idx, idx + p));
+							out.insert(out.end(), subsets.begin() + it->second, subsets.begin() + it->second + p);
+						}
+					}
+				});
+			}
+			return best;
+		}
+	};
+
+   public:
+	IsdDecoder(LinearCode &code, IsdOptions options = {}) : code(code), options(options) {
+		if (this->options.weight < 0) this->options.weight = gilbertVarshamovRadius(code.length(), code.blockLength());
+		if (this->options.threads <= 0) this->options.threads = hardwareThreads();
+		std::cerr << std::format("information set decoder for [{}, {}]-code, target weight {}", code.length(),
+								 code.blockLength(), this->options.weight)
+				  << std::endl;
+	}
+
+	/// (d - 1) / 2 for the smallest d with sum_{i < d} C(n, i) >= 2^(n - k), the
+	/// number of errors a random [n, k] code can be expected to correct
+	static int gilbertVarshamovRadius(int n, int k) {
+		double logVolume = -INFINITY;
+		for (int d = 1; d <= n; ++d) {
+			double term = std::lgamma(n + 1) - std::lgamma(d) - std::lgamma(n - d + 2);
+			logVolume	= std::max(logVolume, term) + std::log1p(std::exp(-std::abs(logVolume - term)));
+			if (logVolume >= (n - k) * std::log(2.0)) return (d - 1) / 2;
+		}
+		return n;
+	}
+
+	/// the lightest error e found with e * check^t = sindrome, empty if none was found within the budget
+	BitMatrix errorFor(const BitMatrix &sindrome) {
+		TRACE_SCOPE("IsdDecoder::errorFor");
+		int n		= code.length();
+		using clock = std::chrono::steady_clock;
+		auto deadline = clock::now() + options.timeLimit;
+
+		std::atomic<int>  best = n + 1;
+		std::atomic<long> iterations = 0;
+		std::mutex		  lock;
+		std::vector<int>  bestSupport;
+		const BitMatrix	 &checkT = code.packedSyndromeMatrix();
+
+		// walks go to the shared pool, so decoding words from pool workers starts no threads
+		ThreadPool::shared().parallelFor(0, options.threads, 1, [&](uint64_t b, uint64_t e) {
+			for (int id = b; id < int(e); ++id) {
+				std::mt19937_64	 rng(options.seed + id);
+				Walk			 walk(checkT, sindrome, rng);
+				std::vector<int> found;
+				while (best > options.weight && iterations++ < options.iterations) {
+					if (options.timeLimit.count() && clock::now() > deadline) break;
+					int w = walk.search(options, best, found);
+					if (w < best) {
+						std::lock_guard guard(lock);
+						if (w < best) {
+							best		= w;
+							bestSupport = found;
+						}
+					}
+					walk.swap(rng);
+				}
+			}
+		});
+
+		if (best > n) return BitMatrix();
+		BitMatrix e(1, n);
+		for (int j : bestSupport)
+			e.flip(0, j);
+		return e;
+	}
+
+	/// corrects codeword in place and returns its message, empty when no error was found
+	NDArray<int, int> decode(NDArray<int, int> &codeword) {
+		BitMatrix word = BitMatrix::fromND(codeword);
+		BitMatrix e	   = errorFor(code.packedSindrome(word));
+		if (e.rows() == 0) {
+			std::cerr << "failed decoding" << std::endl;
+			return NDArray((_, 0), type<int>);
+		}
+		word += e;
+		for (int j = 0; j < word.cols(); ++j)
+			codeword[j] = int(word.get(0, j));
+		return solve(code.generator, codeword);
+	}
+};
@@ -0,0 +1,303 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/// counters, corrections per error weight and log2 bucketed stage latencies of encoding and
+/// decoding. Every thread writes to its own shard, so recording takes no lock, and reading
+/// merges the shards. A disabled registry records nothing and costs one relaxed load per call
+class Metrics {
+   public:
+	enum Counter { BlocksEncoded, BlocksDecoded, DecodeFailures, TableHits, TableMisses, BytesIn, BytesOut, counters };
+	enum Stage { Encode, Sindrome, Lookup, Extract, stages };
+
+	static constexpr int maxWeight = 64;
+	/// bucket b counts latencies in [2^b, 2^(b+1)) nanoseconds, the last one everything longer
+	static constexpr int buckets = 40;
+
+	static constexpr std::array<const char *, counters> counterNames = {
+		"blocks_encoded", "blocks_decoded", "decode_failures", "table_hits", "table_misses", "bytes_in", "bytes_out"};
+	static constexpr std::array<const char *, stages> stageNames = {"encode", "syndrome", "lookup", "extract"};
+
+	/// merged values of every shard at one point in time
+	struct Snapshot {
+		std::array<uint64_t, counters>								 counter{};
+		std::array<uint64_t, maxWeight + 1>							 corrected{};
+		std::array<std::array<uint64_t, buckets>, stages>			 histogram{};
+		std::array<uint64_t, stages>								 nanoseconds{};
+
+		std::string toJson() const;
+		std::string toPrometheus() const;
+	};
+
+   private:
+	/// written by one thread only, the atomics just make reading from others well defined
+	struct Shard {
+		std::array<std::atomic<uint64_t>, counters>							counter{};
+		std::array<std::atomic<uint64_t>, maxWeight + 1>					corrected{};
+		std::array<std::array<std::atomic<uint64_t>, buckets>, stages>		histogram{};
+		std::array<std::atomic<uint64_t>, stages>							nanoseconds{};
+
+		static void add(std::atomic<uint64_t> &x, uint64_t n) {
+			x.store(x.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+		}
+	};
+
+	std::atomic<bool>				   on = false;
+	uint64_t						   id;
+	mutable std::mutex				   lock;
+	std::vector<std::unique_ptr<Shard>> shards;
+
+	static uint64_t nextId() {
+		static std::atomic<uint64_t> ids = 0;
+		return ++ids;
+	}
+
+	/// the calling thread's shard, found by registry id so a new registry at the address of a
+	/// destroyed one does not see its shards
+	Shard &shard() {
+		thread_local std::vector<std::pair<uint64_t, Shard *>> mine;
+		for (auto [owner, s] : mine)
+			if (owner == id) return *s;
+		std::lock_guard guard(lock);
+		Shard		   *s = shards.emplace_back(std::make_unique<Shard>()).get();
+		mine.emplace_back(id, s);
+		return *s;
+	}
+
+   public:
+	Metrics() : id(nextId()) {}
+	Metrics(const Metrics &) = delete;
+
+	/// the registry codes report to unless given another one
+	static Metrics &global() {
+		static Metrics metrics;
+		return metrics;
+	}
+
+	bool enabled() const { return on.load(std::memory_order_relaxed); }
+	void enable(bool value = true) { on = value; }
+
+	void add(Counter c, uint64_t n = 1) {
+		if (enabled()) Shard::add(shard().counter[c], n);
+	}
+	/// one block corrected by an error of the given weight
+	void corrected(int weight) {
+		if (enabled()) Shard::add(shard().corrected[std::min(weight, maxWeight)], 1);
+	}
+	void record(Stage stage, std::chrono::nanoseconds time) {
+		if (!enabled()) return;
+		uint64_t ns = std::max<int64_t>(0, time.count());
+		Shard	&s	= shard();
+		Shard::add(s.histogram[stage][std::min<int>(buckets - 1, std::max(0, int(std::bit_width(ns)) - 1))], 1);
+		Shard::add(s.nanoseconds[stage], ns);
+	}
+
+	/// records the time until it is destroyed, the clock is not read when metrics are disabled
+	class Timer {
+		Metrics								 *metrics;
+		Stage								  stage;
+		std::chrono::steady_clock::time_point start;
+
+	   public:
+		Timer(Metrics &metrics, Stage stage) : metrics(metrics.enabled() ? &metrics : nullptr), stage(stage) {
+			if (this->metrics) start = std::chrono::steady_clock::now();
+		}
+		Timer(const Timer &) = delete;
+		~Timer() {
+			if (metrics) metrics->record(stage, std::chrono::steady_clock::now() - start);
+		}
+	};
+
+	Snapshot snapshot() const {
+		Snapshot		res;
+		std::lock_guard guard(lock);
+		auto			load = [](const std::atomic<uint64_t> &x) { return x.load(std::memory_order_relaxed); };
+		for (auto &s : shards) {
+			for (int c = 0; c < counters; ++c)
+				res.counter[c] += load(s->counter[c]);
+			for (int w = 0; w <= maxWeight; ++w)
+				res.corrected[w] += load(s->corrected[w]);
+			for (int st = 0; st < stages; ++st) {
+				for (int b = 0; b < buckets; ++b)
+					res.histogram[st][b] += load(s->histogram[st][b]);
+				res.nanoseconds[st] += load(s->nanoseconds[st]);
+			}
+		}
+		return res;
+	}
+};
+
+inline std::string Metrics::Snapshot::toJson() const {
+	std::ostringstream out;
+	out << "{\"counters\": {";
+	for (int c = 0; c < counters; ++c)
+		out << (c ? ", " : "") << '"' << counterNames[c] << "\": " << counter[c];
+	out << "}, \"corrected\": {";
+	for (int w = 0, first = 1; w <= maxWeight; ++w)
+		if (corrected[w]) {
+			out << (first ? "" : ", ") << '"' << w << "\": " << corrected[w];
+			first = 0;
+		}
+	out << "}, \"latency_ns\": {";
+	for (int st = 0; st < stages; ++st) {
+		uint64_t count = 0;
+		for (uint64_t h : histogram[st])
+			count += h;
+		out << (st ? ", " : "") << '"' << stageNames[st] << "\": {\"count\": " << count
+			<< ", \"sum\": " << nanoseconds[st] << ", \"log2_buckets\": [";
+		for (int b = 0; b < buckets; ++b)
+			out << (b ? ", " : "") << histogram[st][b];
+		out << "]}";
+	}
+	out << "}}\n";
+	return out.str();
+}
+
+inline std::string Metrics::Snapshot::toPrometheus() const {
+	std::ostringstream out;
+	for (int c = 0; c < counters; ++c)
+		out << "# TYPE code_" << counterNames[c] << "_total counter\ncode_" << counterNames[c] << "_total "
+			<< counter[c] << '\n';
+	out << "# TYPE code_errors_corrected_total counter\n";
+	for (int w = 0; w <= maxWeight; ++w)
+		if (corrected[w]) out << "code_errors_corrected_total{weight=\"" << w << "\"} " << corrected[w] << '\n';
+	out << "# TYPE code_stage_latency_seconds histogram\n";
+	for (int st = 0; st < stages; ++st) {
+		uint64_t cumulative = 0;
+		for (int b = 0; b < buckets - 1; ++b) {
+			cumulative += histogram[st][b];
+			out << "code_stage_latency_seconds_bucket{stage=\"" << stageNames[st] << "\",le=\""
+				<< double(uint64_t(2) << b) * 1e-9 << "\"} " << cumulative << '\n';
+		}
+		cumulative += histogram[st][buckets - 1];
+		out << "code_stage_latency_seconds_bucket{stage=\"" << stageNames[st] << "\",le=\"+Inf\"} " << cumulative
+			<< '\n';
+		out << "code_stage_latency_seconds_sum{stage=\"" << stageNames[st] << "\"} " << double(nanoseconds[st]) * 1e-9
+			<< '\n';
+		out << "code_stage_latency_seconds_count{stage=\"" << stageNames[st] << "\"} " << cumulative << '\n';
+	}
+	return out.str();
+}
+
+/// where and how often a tool dumps its metrics, set from --metrics=TARGET,
+/// --metrics-format=json|prometheus and --metrics-interval=SECONDS
+struct MetricsOptions {
+	/// a file, or unix:PATH for a Unix stream socket. Empty leaves metrics disabled
+	std::string				  target;
+	bool					  prometheus = false;
+	std::chrono::milliseconds interval{0};
+
+	/// takes one command line argument, false if it is not a metrics flag
+	bool parse(const std::string &arg) {
+		auto value = [&](const char *flag) -> const char * {
+			std::size_t len = std::strlen(flag);
+			return arg.compare(0, len, flag) == 0 ? arg.c_str() + len : nullptr;
+		};
+		if (const char *v = value("--metrics=")) target = v;
+		else if (const char *v = value("--metrics-format=")) {
+			std::string format = v;
+			if (format != "json" && format != "prometheus") throw std::runtime_error("unknown metrics format " + format);
+			prometheus = format == "prometheus";
+		} else if (const char *v = value("--metrics-interval="))
+			interval = std::chrono::milliseconds(long(std::stod(v) * 1000));
+		else return false;
+		return true;
+	}
+};
+
+/// enables a registry and writes it to the target of options every interval, when one is
+/// given, and once more when destroyed. Files are replaced whole through a rename
+class MetricsReporter {
+	Metrics				   &metrics;
+	MetricsOptions			options;
+	std::thread				thread;
+	std::mutex				lock;
+	std::condition_variable wake;
+	bool					stopping = false;
+
+	void sendToSocket(const std::string &path, const std::string &text) const {
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(address.sun_path)) throw std::runtime_error("socket path too long: " + path);
+		std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+		int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0) throw std::runtime_error("cannot create socket");
+		if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+			::close(fd);
+			throw std::runtime_error("cannot connect to " + path);
+		}
+		for (std::size_t sent = 0; sent < text.size();) {
+			// a collector that hangs up early must not kill the tool with SIGPIPE
+			ssize_t n = ::send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+			if (n <= 0) {
+				::close(fd);
+				throw std::runtime_error("connection to " + path + " lost");
+			}
+			sent += n;
+		}
+		::close(fd);
+	}
+
+   public:
+	MetricsReporter(Metrics &metrics, MetricsOptions options) : metrics(metrics), options(std::move(options)) {
+		if (this->options.target.empty()) return;
+		metrics.enable();
+		if (this->options.interval.count() > 0)
+			thread = std::thread([this] {
+				std::unique_lock guard(lock);
+				while (!wake.wait_for(guard, this->options.interval, [this] { return stopping; }))
+					write();
+			});
+	}
+	MetricsReporter(const MetricsReporter &) = delete;
+	~MetricsReporter() {
+		if (options.target.empty()) return;
+		{
+			std::lock_guard guard(lock);
+			stopping = true;
+		}
+		wake.notify_all();
+		if (thread.joinable()) thread.join();
+		write();
+	}
+
+	/// one dump, failures are reported on stderr so they never stop the tool
+	void write() const {
+		Metrics::Snapshot snapshot = metrics.snapshot();
+		std::string		  text	   = options.prometheus ? snapshot.toPrometheus() : snapshot.toJson();
+		try {
+			if (options.target.starts_with("unix:")) sendToSocket(options.target.substr(5), text);
+			else {
+				std::string temporary = options.target + ".tmp";
+				std::ofstream(temporary) << text;
+				if (std::rename(temporary.c_str(), options.target.c_str()) != 0)
+					throw std::runtime_error("cannot write " + options.target);
+			}
+		} catch (const std::exception &e) {
+			std::cerr << "metrics: " << e.what() << std::endl;
+		}
+	}
+};
@@ -96,8 +96,31 @@ struct type_t {};
 template <typename T>
 inline type_t<T> type{};
 
+/// tag base of every ND container, lets free operators recognise them
+struct NDBase {};
+/// tag base of lazy element-wise expressions (see expr.hpp)
+struct ExprBase {};
+
+template <class T>
+concept NDLike = std::is_base_of_v<NDBase, std::remove_cvref_t<T>>;
+
+template <class T>
+concept Expression = std::is_base_of_v<ExprBase, std::remove_cvref_t<T>>;
+
+/// containers whose elements can be addressed with a single row-major index
+template <class T>
+concept Linear = requires(T &t) { t.getLinear(std::size_t{}); };
+
+/// containers that may expose their elements as one contiguous row-major
+/// buffer, denseData() returns nullptr when this particular view is not dense
+template <class T>
+concept Dense = requires(T &t) { t.denseData(); };
+
+template <class T>
+constexpr std::size_t ndRank = std::tuple_size_v<decltype(std::declval<T &>().shape())>;
+
 template <class Container, class... Args>
-class ND {
+class ND : public NDBase {
    public:
 	using Internal = Container;
 
@@ -154,6 +177,23 @@ class ND {
 		requires(sizeof...(Args) > 0)
 	{
 		if (This().shape() != other.shape()) { throw std::runtime_error("ND dimensions do not match"); }
+		if constexpr (Dense<Container> && Dense<T>) {
+			auto *dst = This().denseData();
+			auto *src = other.denseData();
+			if (dst && src) {
+				for (std::size_t i = 0, n = size(); i < n; ++i) {
+					dst[i] = src[i];
+				}
+				return This();
+			}
+		}
+		if constexpr (Linear<Container> && Linear<T> && Expression<T>) {
+			// the whole expression tree is evaluated in one flat pass
+			for (std::size_t i = 0, n = size(); i < n; ++i) {
+				This().getLinear(i) = other.getLinear(i);
+			}
+			return This();
+		}
 		for (int i = 0; i < get<0>(shape()); ++i) {
 			This()[i] = other[i];
 		}
@@ -162,7 +202,7 @@ class ND {
 
 	template <class T>
 	auto &operator=(const T &other)
-		requires(sizeof...(Args) == 0 && std::is_fundamental_v<T>)
+		requires(sizeof...(Args) == 0 && !NDLike<T>)
 	{
 		This()[] = other;
 		return This();
@@ -170,7 +210,7 @@ class ND {
 
 	template <class T>
 	Container &operator=(T &&other)
-		requires(sizeof...(Args) == 0 && !std::is_fundamental_v<T>)
+		requires(sizeof...(Args) == 0 && NDLike<T>)
 	{
 		This()[] = other[];
 		return This();
@@ -188,7 +228,7 @@ class ND {
 	}
 	template <class T>
 	auto &assign(const T &other)
-		requires(sizeof...(Args) == 0 && std::is_fundamental_v<T>)
+		requires(sizeof...(Args) == 0 && !NDLike<T>)
 	{
 		This()[] = other;
 		return This();
@@ -196,7 +236,7 @@ class ND {
 
 	template <class T>
 	Container &assign(T &&other)
-		requires(sizeof...(Args) == 0 && !std::is_fundamental_v<T>)
+		requires(sizeof...(Args) == 0 && NDLike<T>)
 	{
 		This()[] = other[];
 		return This();
@@ -206,6 +246,14 @@ class ND {
 	ND<Container, Args...> &apply(T &&f)
 		requires(sizeof...(Args) > 0)
 	{
+		if constexpr (Dense<Container>) {
+			if (auto *p = This().denseData()) {
+				for (std::size_t i = 0, n = size(); i < n; ++i) {
+					p[i] = f(p[i]);
+				}
+				return *this;
+			}
+		}
 		for (int i = 0; i < get<0>(shape()); ++i) {
 			This()[i].apply(f);
 		}
@@ -224,6 +272,16 @@ class ND {
 		requires(sizeof...(Args) > 0)
 	{
 		static_assert(std::tuple_size<decltype(arr.shape())>() == sizeof...(Args));
+		if constexpr (Dense<Container> && Dense<Arr>) {
+			auto *p = This().denseData();
+			auto *q = arr.denseData();
+			if (p && q && shape() == arr.shape()) {
+				for (std::size_t i = 0, n = size(); i < n; ++i) {
+					p[i] = f(p[i], q[i]);
+				}
+				return *this;
+			}
+		}
 		for (int i = 0; i < get<0>(shape()); ++i) {
 			This()[i].apply2(std::forward<T>(f), arr[i]);
 		}
@@ -291,13 +349,13 @@ class ND {
 
 	template <class T>
 	bool operator==(const T &other)
-		requires(sizeof...(Args) == 0 && std::is_fundamental_v<T>)
+		requires(sizeof...(Args) == 0 && !NDLike<T>)
 	{
 		return This()[] == other;
 	}
 	template <class T>
 	bool operator==(T &&other)
-		requires(sizeof...(Args) == 0 && !std::is_fundamental_v<T>)
+		requires(sizeof...(Args) == 0 && NDLike<T>)
 	{
 		return This()[] == other[];
 	}
@@ -307,6 +365,16 @@ class ND {
 		requires(sizeof...(Args) > 0)
 	{
 		if (shape() != other.shape()) { return false; }
+		if constexpr (Dense<Container> && Dense<T>) {
+			auto *p = This().denseData();
+			auto *q = other.denseData();
+			if (p && q) {
+				for (std::size_t i = 0, n = size(); i < n; ++i) {
+					if (!(p[i] == q[i])) { return false; }
+				}
+				return true;
+			}
+		}
 		for (int i = 0; i < std::get<0>(shape()); ++i) {
 			if (!(This()[i].operator==(other[i]))) { return false; }
 		}
@@ -5,6 +5,7 @@
 #include <tuple>
 #include <cassert>
 
+#include "arena.hpp"
 #include "autoref.hpp"
 #include <nd.hpp>
 
@@ -18,6 +19,8 @@ class NDArray : public ND<NDArray<T, Args...>, Args...> {
 	using Elem = T;
 	NDArray(std::tuple<Args...> dim, type_t<T> t = type<T>);
 	NDArray(std::tuple<Args...> dim, type_t<T> t, std::istream &in);
+	/// scratch array living in arena, valid until the enclosing Arena::Scope ends
+	NDArray(std::tuple<Args...> dim, type_t<T> t, Arena &arena);
 	NDArray(NDArray &other);
 	NDArray(NDArray &&other) = default;
 
@@ -64,6 +67,23 @@ class NDArray : public ND<NDArray<T, Args...>, Args...> {
 		return data[offset];
 	}
 
+	/// element at row-major position i, NDArrays are always dense
+	T &getLinear(std::size_t i) { return data[offset + i]; }
+	T *denseData() { return &data + offset; }
+
+	/// rank 1 arrays are walked with raw pointers, contiguous iterators the compiler can vectorize,
+	/// instead of ND::Iterator which builds a sub-array for every element
+	T *begin()
+		requires(sizeof...(Args) == 1)
+	{
+		return denseData();
+	}
+	T *end()
+		requires(sizeof...(Args) == 1)
+	{
+		return denseData() + this->size();
+	}
+
 	auto operator[](int index)
 		requires(sizeof...(Args) > 0)
 	{
@@ -90,6 +110,9 @@ NDArray(std::tuple<Args...>, T *, std::size_t, std::size_t) -> NDArray<T, Args..
 template <class T, class... Args>
 NDArray(std::tuple<Args...>, type_t<T>, std::istream &) -> NDArray<T, Args...>;
 
+template <class T, class... Args>
+NDArray(std::tuple<Args...>, type_t<T>, Arena &) -> NDArray<T, Args...>;
+
 // --------------------------------------------------------------------------------------------------------------------
 
 template <class T, class... Args>
@@ -104,6 +127,12 @@ NDArray<T, Args...>::NDArray(std::tuple<Args...> dim, type_t<T>)
 	static_assert((std::is_integral_v<Args> && ...), "ND constructor requires integral dimensions");
 }
 
+template <class T, class... Args>
+NDArray<T, Args...>::NDArray(std::tuple<Args...> dim, type_t<T>, Arena &arena)
+	: Parent(dim), data(*arena.allocate<T>(Parent::size())), offset(0) {
+	static_assert((std::is_integral_v<Args> && ...), "ND constructor requires integral dimensions");
+}
+
 template <class T, class... Args>
 NDArray<T, Args...>::NDArray(NDArray &other)
 	: Parent(other.dimensions), data(&other.data + other.offset, other.size()), offset(other.offset) {
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// number of worker threads used by the parallel algorithms
+inline int hardwareThreads() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+/// runs f(b, e) on contiguous chunks [b, e) of [begin, end), one chunk per core.
+/// ranges with fewer than grain elements per chunk stay on the calling thread
+template <class F>
+void parallelFor(int begin, int end, int grain, F &&f) {
+	int n		= end - begin;
+	int threads = std::min(hardwareThreads(), grain > 0 ? n / grain : n);
+	if (threads <= 1) {
+		if (n > 0) f(begin, end);
+		return;
+	}
+
+	int						 chunk = (n + threads - 1) / threads;
+	std::vector<std::thread> workers;
+	for (int b = begin + chunk; b < end; b += chunk) {
+		workers.emplace_back([&f, b, e = std::min(end, b + chunk)] { f(b, e); });
+	}
+	f(begin, std::min(end, begin + chunk));
+	for (auto &w : workers)
+		w.join();
+}
+
+/// fixed set of worker threads running queued tasks. A thread waiting for its own tasks
+/// helps running the queue, so pool tasks can use the pool themselves
+class ThreadPool {
+	std::vector<std::thread>		  workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex						  lock;
+	std::condition_variable			  ready;
+	bool							  stopping = false;
+
+	bool runOne() {
+		std::function<void()> task;
+		{
+			std::lock_guard guard(lock);
+			if (tasks.empty()) return false;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+		return true;
+	}
+
+   public:
+	explicit ThreadPool(int threads = hardwareThreads()) {
+		for (int i = 0; i < threads; ++i)
+			workers.emplace_back([this] {
+				while (true) {
+					std::function<void()> task;
+					{
+						std::unique_lock guard(lock);
+						ready.wait(guard, [this] { return stopping || !tasks.empty(); });
+						if (tasks.empty()) return;
+						task = std::move(tasks.front());
+						tasks.pop_front();
+					}
+					task();
+				}
+			});
+	}
+	ThreadPool(const ThreadPool &) = delete;
+	~ThreadPool() {
+		{
+			std::lock_guard guard(lock);
+			stopping = true;
+		}
+		ready.notify_all();
+		for (auto &w : workers)
+			w.join();
+	}
+
+	/// the pool shared by the whole process, one thread per core
+	static ThreadPool &shared() {
+		static ThreadPool pool;
+		return pool;
+	}
+
+	int size() const { return workers.size(); }
+
+	template <class F>
+	auto submit(F &&f) {
+		using R	  = std::invoke_result_t<F>;
+		auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+		auto res  = task->get_future();
+		{
+			std::lock_guard guard(lock);
+			tasks.emplace_back([task] { (*task)(); });
+		}
+		ready.notify_one();
+		return res;
+	}
+
+	/// waits for f, running queued tasks meanwhile
+	template <class R>
+	R wait(std::future<R> &f) {
+		while (f.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			if (!runOne()) f.wait_for(std::chrono::microseconds(100));
+		return f.get();
+	}
+
+	/// f(b, e) on chunks of [begin, end) of at least grain elements, returns when all are done
+	template <class F>
+	void parallelFor(uint64_t begin, uint64_t end, uint64_t grain, F &&f) {
+		if (begin >= end) return;
+		uint64_t chunks = std::min<uint64_t>(4 * (size() + 1), std::max<uint64_t>(1, (end - begin) / grain));
+		uint64_t chunk	= (end - begin + chunks - 1) / chunks;
+
+		std::vector<std::future<void>> pending;
+		for (uint64_t b = begin + chunk; b < end; b += chunk)
+			pending.push_back(submit([&f, b, e = std::min(end, b + chunk)] { f(b, e); }));
+		f(begin, std::min(end, begin + chunk));
+		for (auto &p : pending)
+			wait(p);
+	}
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <optional>
+#include <vector>
+
+#include "arena.hpp"
+#include "bitmatrix.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+
+/// reduced row echelon form of a GF(2) matrix. Built block-recursively: the left
+/// half of the columns is reduced first, the right half is reduced on the rows
+/// without a pivot yet, and the pivot rows of the left half are then cleared of
+/// the right half's pivot columns with one M4RM product. Blocks of at most
+/// leafColumns columns are reduced 8 columns at a time with Gray code tables
+/// (the Method of Four Russians for elimination). Rank deficient input is fine,
+/// columns without a pivot are simply recorded as free
+class Echelon {
+	BitMatrix		 rref;
+	std::vector<int> pivots;
+
+	static constexpr int leafColumns = 512;
+	static constexpr int stripWidth	 = 8;
+
+	/// reduces columns [c0, c1) of rows [r0, rows), returns how many pivots were found.
+	/// columns before c0 are already zero in those rows, so all work starts at word c0 / 64
+	int reduce(int r0, int c0, int c1) {
+		if (c1 - c0 <= leafColumns) return reduceLeaf(r0, c0, c1);
+
+		int mid = c0 + (c1 - c0) / 2 / BitMatrix::wordBits * BitMatrix::wordBits;
+		int p1	= reduce(r0, c0, mid);
+		int p2	= reduce(r0 + p1, mid, c1);
+		if (p1 == 0 || p2 == 0) return p1 + p2;
+
+		// the left half's pivot rows T still have ones in the right half's pivot columns.
+		// with X the entries of T in those columns and P2 the right pivot rows: T += X * P2
+		int		  width = rref.cols() - mid;
+		BitMatrix x(p1, p2);
+		for (int i = 0; i < p1; ++i)
+			for (int j = 0; j < p2; ++j)
+				if (rref.get(r0 + i, pivots[r0 + p1 + j])) x.set(i, j);
+		BitMatrix right = rref.block(r0 + p1, mid, p2, width);
+		BitMatrix top	= rref.block(r0, mid, p1, width);
+		if (p1 < 512) m4rmAdd(x, right, top);
+		else {
+			// independent row bands of T, each with its own Gray code tables
+			int					   band = (p1 + hardwareThreads() - 1) / hardwareThreads();
+			std::vector<BitMatrix> parts((p1 + band - 1) / band);
+			parallelFor(0, int(parts.size()), 1, [&](int b, int e) {
+				for (int t = b; t < e; ++t) {
+					int rows = std::min(band, p1 - t * band);
+					parts[t] = top.block(t * band, 0, rows, width);
+					m4rmAdd(x.block(t * band, 0, rows, p2), right, parts[t]);
+				}
+			});
+			for (std::size_t t = 0; t < parts.size(); ++t)
+				top.setBlock(t * band, 0, parts[t]);
+		}
+		rref.setBlock(r0, mid, top);
+		return p1 + p2;
+	}
+
+	int reduceLeaf(int r0, int c0, int c1) {
+		int rows  = rref.rows();
+		int words = rref.words();
+		int w0	  = c0 / BitMatrix::wordBits;
+		int r	  = r0;
+
+		Arena::Scope scratch;
+		uint64_t	*table = scratch.arena.allocate<uint64_t>(std::size_t(words) << stripWidth);
+
+		for (int s = c0; s < c1 && r < rows; s += stripWidth) {
+			int		 e = std::min(s + stripWidth, c1);
+			// strips never cross a word since c0 is a multiple of 64
+			uint64_t stripMask = ((uint64_t(1) << (e - s)) - 1) << (s % BitMatrix::wordBits);
+			int		 sw		   = s / BitMatrix::wordBits;
+
+			// find up to 8 pivots, every candidate row is first reduced by the ones found so far
+			int p = 0;
+			for (int i = r; i < rows && p < e - s; ++i) {
+				for (int j = 0; j < p; ++j)
+					if (rref.get(i, pivots[r + j])) xorFrom(i, r + j, w0);
+				uint64_t bits = rref.row(i)[sw] & stripMask;
+				if (!bits) continue;
+				rref.swapRows(i, r + p);
+				pivots.push_back(sw * BitMatrix::wordBits + std::countr_zero(bits));
+				++p;
+			}
+			if (p == 0) continue;
+
+			// make the strip's pivot rows reduced among themselves and sort them by pivot column
+			for (int j = p - 1; j >= 0; --j)
+				for (int i = 0; i < j; ++i)
+					if (rref.get(r + i, pivots[r + j])) xorFrom(r + i, r + j, w0);
+			for (int i = 1; i < p; ++i)
+				for (int j = i; j > 0 && pivots[r + j - 1] > pivots[r + j]; --j) {
+					std::swap(pivots[r + j - 1], pivots[r + j]);
+					rref.swapRows(r + j - 1, r + j);
+				}
+
+			// all 2^p sums of the pivot rows, in Gray code order so each costs one row XOR
+			std::fill_n(table + std::size_t(w0), words - w0, 0);
+			for (int idx = 1; idx < (1 << p); ++idx) {
+				int				gray	 = idx ^ (idx >> 1);
+				int				previous = (idx - 1) ^ ((idx - 1) >> 1);
+				int				bit		 = std::countr_zero(unsigned(gray ^ previous));
+				const uint64_t *src		 = rref.row(r + bit);
+				uint64_t	   *dst		 = table + std::size_t(gray) * words;
+				uint64_t	   *old		 = table + std::size_t(previous) * words;
+				for (int w = w0; w < words; ++w)
+					dst[w] = old[w] ^ src[w];
+			}
+
+			// every other row loses its bits in the pivot columns with a single table row. This
+			// runs once per strip, so it goes to the shared pool rather than a fresh thread team
+			int pr = r;
+			ThreadPool::shared().parallelFor(r0, rows, 4096, [&](uint64_t b, uint64_t end) {
+				for (int i = b; i < int(end); ++i) {
+					if (i >= pr && i < pr + p) continue;
+					unsigned idx = 0;
+					for (int j = 0; j < p; ++j)
+						idx |= unsigned(rref.get(i, pivots[pr + j])) << j;
+					if (!idx) continue;
+					const uint64_t *src = table + std::size_t(idx) * words;
+					uint64_t	   *dst = rref.row(i);
+					for (int w = w0; w < words; ++w)
+						dst[w] ^= src[w];
+				}
+			});
+			r += p;
+		}
+		return r - r0;
+	}
+
+	void xorFrom(int i, int j, int w0) {
+		uint64_t	   *dst = rref.row(i);
+		const uint64_t *src = rref.row(j);
+		for (int w = w0; w < rref.words(); ++w)
+			dst[w] ^= src[w];
+	}
+
+   public:
+	Echelon(BitMatrix a) : rref(std::move(a)) {
+		TRACE_SCOPE("Echelon");
+		reduce(0, 0, rref.cols());
+	}
+
+	int						rank() const { return pivots.size(); }
+	const std::vector<int> &pivotColumns() const { return pivots; }
+	const BitMatrix		   &reduced() const { return rref; }
+
+	/// rows form a basis of {x : a x^t = 0}, one row per free column
+	BitMatrix nullspace() const {
+		int				  n = rref.cols();
+		std::vector<bool> isPivot(n, false);
+		for (int p : pivots)
+			isPivot[p] = true;
+
+		BitMatrix res(n - rank(), n);
+		int		  k = 0;
+		for (int f = 0; f < n; ++f) {
+			if (isPivot[f]) continue;
+			res.set(k, f);
+			for (int i = 0; i < rank(); ++i)
+				if (rref.get(i, f)) res.set(k, pivots[i]);
+			++k;
+		}
+		return res;
+	}
+
+	/// for an echelon form of the augmented matrix [a | b], a solution x of a x^t = b
+	/// with every free variable set to 0, or nothing when the system is inconsistent
+	std::optional<BitMatrix> augmentedSolution() const {
+		int n = rref.cols() - 1;
+		if (rank() > 0 && pivots.back() == n) return std::nullopt;
+		BitMatrix x(1, n);
+		for (int i = 0; i < rank(); ++i)
+			if (rref.get(i, n)) x.set(0, pivots[i]);
+		return x;
+	}
+};
@@ -1,29 +1,39 @@
 #pragma once
+#include <algorithm>
 #include <cmath>
 #include <exception>
 #include <ndarray.hpp>
+#include <expr.hpp>
+#include <slice.hpp>
+#include <strided.hpp>
 #include <tuple>
 #include <type_traits>
 #include "autoref.hpp"
+#include "field.hpp"
+#include "gemm.hpp"
+#include "trace.hpp"
 
 inline int mod2(int x) {
 	return x & 1;
 }
 
 template <class T, class... Args>
-	requires std::is_fundamental<T>::value
-class Zeros : public NDArray<int, Args...> {
+	requires std::is_trivially_copyable_v<T>
+class Zeros : public NDArray<T, Args...> {
    public:
-	Zeros(std::tuple<Args...> dim, type_t<T> = type<int>) : NDArray<int, Args...>(dim) {
-		memset(&this->data, 0, sizeof(T) * this->size());
+	Zeros(std::tuple<Args...> dim, type_t<T> = type<int>) : NDArray<T, Args...>(dim) {
+		std::fill_n(&this->data, this->size(), T{});
 	}
-	using NDArray<int, Args...>::operator=;
+	Zeros(std::tuple<Args...> dim, type_t<T>, Arena &arena) : NDArray<T, Args...>(dim, type<T>, arena) {
+		std::fill_n(&this->data, this->size(), T{});
+	}
+	using NDArray<T, Args...>::operator=;
 
-	using Elem = int;
+	using Elem = T;
 };
 
 template <class T, class... Args>
-	requires std::is_fundamental<T>::value
+	requires std::is_trivially_copyable_v<T>
 class Ones : public NDArray<T, Args...> {
    public:
 	Ones(std::tuple<Args...> dim, type_t<T> = type<int>) : NDArray<T, Args...>(dim) {
@@ -55,6 +65,12 @@ Repeat(U&& array, std::size_t dim, std::tuple<Args...>, type_t<T>) -> Repeat<T,
 
 inline int mod(int k, int n) { return ((k %= n) < 0) ? k + n : k; }
 
+/// mod(k, n) without a division for the common case -n <= k < 2n
+inline int wrap(int k, int n) {
+	if (k < 0) return k >= -n ? k + n : mod(k, n);
+	return k < n ? k : (k < 2 * n ? k - n : mod(k, n));
+}
+
 template <class Container, class... Args>
 class Cycle : public ND<Cycle<Container, Args...>, Args...> {
 	AutoRef<Container> data;
@@ -68,19 +84,27 @@ class Cycle : public ND<Cycle<Container, Args...>, Args...> {
 		static_assert((std::is_integral_v<Args> && ...), "ND constructor requires integral dimensions");
 	}
 
-	auto operator[](std::size_t index)
+	auto operator[](int index)
 		requires(sizeof...(Args) > 0)
 	{
-		int i = ::mod(index, get<0>(this->shape()));
+		int i = ::wrap(index, get<0>(this->shape()));
 		assert(i <= get<0>(this->shape()));
-		return ::Cycle(std::move((*data)[i]), pop_front(this->shape()));
+		if constexpr (StridedViewable<Container>) {
+			return ::Cycle(stridedView(*data)[i], pop_front(this->shape()));
+		} else {
+			return ::Cycle(std::move((*data)[i]), pop_front(this->shape()));
+		}
 	}
 	auto &operator[](Args... indices)
 		requires(sizeof...(indices) == sizeof...(Args) && sizeof...(indices) != 1)
 	{
 		auto ind = mod_v(std::forward_as_tuple(indices...), this->shape());
 		return [&]<size_t... p>(std::index_sequence<p...>) -> auto & {
-			return (*data)[(std::get<p>(ind))...];
+			if constexpr (StridedViewable<Container>) {
+				return stridedView(*data).at((std::get<p>(ind))...);
+			} else {
+				return (*data)[(std::get<p>(ind))...];
+			}
 		}(std::make_index_sequence<sizeof...(Args)>());
 	}
 
@@ -90,7 +114,7 @@ class Cycle : public ND<Cycle<Container, Args...>, Args...> {
 
 	static std::tuple<Args...> mod_v(std::tuple<Args...> ind, std::tuple<Args...> dim) {
 		[&]<auto... p>(std::index_sequence<p...>) {
-			((std::get<p>(ind) = mod(std::get<p>(ind), std::get<p>(dim))), ...);
+			((std::get<p>(ind) = wrap(std::get<p>(ind), std::get<p>(dim))), ...);
 		}(std::make_index_sequence<sizeof...(Args)>{});
 		return ind;
 	}
@@ -98,15 +122,19 @@ class Cycle : public ND<Cycle<Container, Args...>, Args...> {
 template <class U, class... Args>
 Cycle(U &&, std::tuple<Args...>) -> Cycle<U, Args...>;
 
-template<class Container, class ...Args>
-class Transpose : public ND<Transpose<Container, Args...>, Args...> {
-	AutoRef<Container> data;
-	using Parent = ND<Transpose<Container, Args...>, Args...>;
+/// O(1) transposed view of a dense rank-2 container
+template <class T>
+class Transpose : public Strided<T, int, int> {
+	using Parent = Strided<T, int, int>;
 
-public:
-	using Elem = std::remove_reference_t<Container>::Elem;
+   public:
+	template <class U>
+	Transpose(U &&array) : Parent(stridedView(array).transpose()) {}
 
+	using Parent::operator=;
 };
+template <class U>
+Transpose(U &&) -> Transpose<typename std::remove_reference_t<U>::Elem>;
 
 
 template <class T>
@@ -143,52 +171,55 @@ void assign(U &&u, std::tuple<int, int> shape, V &&v) {
 }
 
 template<class A, class B>
-int dot(A && a, B && b) {
-	int res = 0;
+auto dot(A && a, B && b) {
+	using T = std::remove_reference_t<A>::Elem;
+	T res{};
 	for(int i = 0; i < std::get<0>(a.shape()); ++i) {
-		res += a[i] * b[i];
+		res += T(a[i]) * T(b[i]);
 	}
 	return res;
 }
 
-/// [k] x [k, n] -> [n]
-template<class A, class M>
-auto vecMatMul(A && a, M && m) {
+/// [k] x [k, n] -> [n], the result is allocated from arena when one is given
+template<class A, class M, class... Alloc>
+auto vecMatMul(A && a, M && m, Alloc &...arena) {
 	auto [k1] = a.shape();
 	auto [k2, n] = m.shape();
 	assert(k1 == k2 && "dimensions must match");
 	auto k = k1;
-	auto res = Zeros((_, n), type<int>);
+	auto res = Zeros((_, n), type<typename std::remove_reference_t<M>::Elem>, arena...);
 
-	auto exp1 = Zeros((_, n), type<int>);
 	for(int i = 0; i < k; ++i) {
-		exp1 = m[i];
-		exp1.multScalar(a[i]);
-		res += exp1;
+		res = res + m[i] * a[i];
 	}
 	return res;
 }
 
+/// Hamming weight, the number of nonzero entries
 template< class A>
 int w(A && a) {
+	using T = std::remove_reference_t<A>::Elem;
 	int res = 0;
 	for(int i = 0; i < std::get<0>(a.shape()); ++i) {
-		res += a[i];
+		res += T(a[i]) != T{};
 	}
 	return res;
 }
 
 template<class V, class G>
 inline bool isSolution(V && v, G && g) {
+	using T = std::remove_reference_t<G>::Elem;
 	for(int i = 0; i < std::get<0>(g.shape()); ++i) {
-		if(dot(g[i], v) % 2 != 0) {
+		if(FieldTraits<T>::reduce(dot(g[i], v)) != T{}) {
 			return false;
 		}
 	}
 	return true;
 }
-template<class U, class V, class T>
-auto matmul(U && u, V && v, type_t<T> = type<T>) {
+/// res += u * v, res must already have shape [n, k]
+template<class R, class U, class V>
+void matmulInto(R && res, U && u, V && v) {
+	using T = std::remove_reference_t<R>::Elem;
 	auto [n, m1] = u.shape();
 	auto [m2, k] = v.shape();
 	if(m1 != m2) {
@@ -196,18 +227,41 @@ auto matmul(U && u, V && v, type_t<T> = type<T>) {
 	}
 	assert(m1 == m2 && "dimensions must match");
 
-	auto vt = NDArray((_, k, m2), type<T>);
-	assignTransposed(vt, vt.shape(), v);
-	auto res = NDArray((_, n, k), type<T>);
-	for(int i = 0; i < n; ++i) 
-		for(int j = 0; j < k; ++j)
-			res[i][j] = dot(u[i], vt[j]);
+	if constexpr (std::is_same_v<T, int> && Dense<R> && Dense<U> && Dense<V>) {
+		using UE = std::remove_reference_t<U>::Elem;
+		using VE = std::remove_reference_t<V>::Elem;
+		if constexpr (std::is_same_v<UE, int> && std::is_same_v<VE, int>) {
+			int *c = res.denseData();
+			int *a = u.denseData();
+			int *b = v.denseData();
+			if (a && b && c) { return gemmParallel(n, m1, k, a, m1, b, k, c, k); }
+		}
+	}
 
+	// accumulating whole rows of v walks both operands in storage order,
+	// so v never has to be transposed
+	for(int i = 0; i < n; ++i) {
+		auto row = res[i];
+		for(int l = 0; l < m1; ++l) {
+			T x = u[i][l];
+			if(x != T{}) row = row + v[l] * x;
+		}
+	}
+}
+
+/// the result is allocated from arena when one is given
+template<class U, class V, class T, class... Alloc>
+auto matmul(U && u, V && v, type_t<T> = type<T>, Alloc &...arena) {
+	TRACE_SCOPE("matmul");
+	int n = std::get<0>(u.shape());
+	int k = std::get<1>(v.shape());
+	NDArray<T, int, int> res = Zeros((_, n, k), type<T>, arena...);
+	matmulInto(res, u, v);
 	return res;
 }
 
-template<class U, class V, class T>
-auto matmul_fancy(U && u, V && v, type_t<T> = type<T>) {
+template<class U, class V, class T, class... Alloc>
+auto matmul_fancy(U && u, V && v, type_t<T> = type<T>, Alloc &...arena) {
 	constexpr bool u1 = std::tuple_size_v<decltype(u.shape())> == 1;
 	constexpr bool v1 = std::tuple_size_v<decltype(v.shape())> == 1;
 
@@ -215,16 +269,11 @@ auto matmul_fancy(U && u, V && v, type_t<T> = type<T>) {
 		auto res = NDArray(_, type<int>);
 		res[] = dot(u, v);
 	} else if constexpr (u1) {
-		return matmul(Repeat(u, 1, u.shape(), type<T>), v, type<T>); 
+		return matmul(stridedView(u).broadcast(1), v, type<T>, arena...); 
 	} else if constexpr (v1) {
-		int l = std::get<0>(v.shape());
-		auto my_v = NDArray((_, l, 1), type<int>);
-		for(int i = 0; i < l; ++i) {
-			my_v[i][0] = v[i];
-		}
-		return matmul(u, my_v, type<T>); 
+		return matmul(u, stridedView(v).broadcast(1).transpose(), type<T>, arena...); 
 	} else {
-		return matmul(u, v);
+		return matmul(u, v, type<T>, arena...);
 	}
 
 }
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "bitmatrix.hpp"
+#include "code.hpp"
+#include "cyclic.hpp"
+#include "decoder.hpp"
+#include "hamming.hpp"
+#include "metrics.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+
+/// corrects packed words of a binary code in place with the decoder the decode tool would pick:
+/// the syndrome position for Hamming codes, the Meggitt table for cyclic codes and the syndrome
+/// table otherwise. Several threads may correct words at once
+class ComponentDecoder {
+	std::optional<HammingCode>		 hamming;
+	std::optional<CyclicCode>		 cyclic;
+	std::unique_ptr<SindromeDecoder> table;
+
+   public:
+	explicit ComponentDecoder(LinearCode &code) {
+		hamming = HammingCode::fromLinearCode(code);
+		if (hamming) return;
+		cyclic = CyclicCode::fromLinearCode(code);
+		if (cyclic) return;
+		table = std::make_unique<SindromeDecoder>(code);
+	}
+
+	/// false when the word has more errors than the code corrects, the word is then unchanged
+	bool correct(uint64_t *word) const {
+		if (hamming) return hamming->correct(word);
+		if (table) return table->correct(word);
+		auto res = cyclic->correct(word[0]);
+		if (res) word[0] = *res;
+		return bool(res);
+	}
+};
+
+/// bits at the given positions of a packed word, packed in that order into out
+inline void gatherBits(const uint64_t *word, const std::vector<int> &positions, uint64_t *out) {
+	std::fill(out, out + BitMatrix::wordsFor(positions.size()), 0);
+	for (std::size_t i = 0; i < positions.size(); ++i)
+		if (word[positions[i] / 64] >> (positions[i] % 64) & 1) out[i / 64] |= uint64_t(1) << (i % 64);
+}
+
+/// the product of a row code [n1, k1, d1] and a column code [n2, k2, d2]: the n2 x n1 blocks
+/// whose rows are in the row code and whose columns are in the column code, a [n1 n2, k1 k2,
+/// d1 d2] code. Messages are k2 x k1 blocks encoded systematically by both codes, so they are
+/// read back from the information positions
+class ProductCode {
+	LinearCode		&rowCode;
+	LinearCode		&columnCode;
+	ComponentDecoder rowDecoder;
+	ComponentDecoder columnDecoder;
+	std::vector<int> rowInformation;
+	std::vector<int> columnInformation;
+
+	struct Pass {
+		int changed = 0;
+		int failed	= 0;
+	};
+
+	/// corrects every row of a on the shared pool and flips the corrected bits in its transpose
+	/// at as well, so the other pass reads its words from memory as fresh as a's
+	static Pass correctRows(BitMatrix &a, BitMatrix &at, const ComponentDecoder &decoder) {
+		Pass							 res;
+		std::mutex						 lock;
+		std::vector<std::pair<int, int>> flips;
+		ThreadPool::shared().parallelFor(0, a.rows(), 16, [&](uint64_t b, uint64_t e) {
+			std::vector<std::pair<int, int>> mine;
+			std::vector<uint64_t>			 before(a.words());
+			int								 failed = 0;
+			for (int i = b; i < int(e); ++i) {
+				std::copy_n(a.row(i), a.words(), before.begin());
+				if (!decoder.correct(a.row(i))) {
+					++failed;
+					continue;
+				}
+				for (int w = 0; w < a.words(); ++w)
+					for (uint64_t d = before[w] ^ a.row(i)[w]; d; d &= d - 1)
+						mine.emplace_back(i, w * BitMatrix::wordBits + std::countr_zero(d));
+			}
+			std::lock_guard guard(lock);
+			flips.insert(flips.end(), mine.begin(), mine.end());
+			res.failed += failed;
+		});
+		for (auto [i, j] : flips)
+			at.flip(j, i);
+		res.changed = flips.size();
+		return res;
+	}
+
+   public:
+	/// both codes must outlive the product
+	ProductCode(LinearCode &rows, LinearCode &columns)
+		: rowCode(rows), columnCode(columns), rowDecoder(rows), columnDecoder(columns),
+		  rowInformation(rows.informationPositions()), columnInformation(columns.informationPositions()) {
+		if (int(rowInformation.size()) != rows.blockLength() || int(columnInformation.size()) != columns.blockLength())
+			throw std::runtime_error("generator does not have full rank");
+	}
+
+	/// n2 x n1 blocks
+	int rows() { return columnCode.length(); }
+	int cols() { return rowCode.length(); }
+	int length() { return rows() * cols(); }
+	int blockLength() { return rowCode.blockLength() * columnCode.blockLength(); }
+
+	/// the n2 x n1 codeword of a k2 x k1 message: the rows encoded, then the columns
+	BitMatrix encode(const BitMatrix &message) {
+		TRACE_SCOPE("ProductCode::encode");
+		if (message.rows() != columnCode.blockLength() || message.cols() != rowCode.blockLength())
+			throw std::runtime_error("BitMatrix dimensions do not match");
+		BitMatrix encodedRows = rowCode.packedEncodeSystematic(message);
+		return columnCode.packedEncodeSystematic(encodedRows.transposed()).transposed();
+	}
+
+	/// the k2 x k1 message of an n2 x n1 codeword
+	BitMatrix message(const BitMatrix &block) const {
+		BitMatrix res(columnInformation.size(), rowInformation.size());
+		for (std::size_t i = 0; i < columnInformation.size(); ++i)
+			gatherBits(block.row(columnInformation[i]), rowInformation, res.row(i));
+		return res;
+	}
+
+	/// corrects a received n2 x n1 block in place by decoding all rows, then all columns, on the
+	/// shared pool until a column pass changes nothing. The columns are decoded from a transposed
+	/// copy that every pass keeps up to date with the bits it flips. False when some row or
+	/// column stays undecodable or iterations run out
+	bool decode(BitMatrix &block, int iterations = 8) {
+		TRACE_SCOPE("ProductCode::decode");
+		if (block.rows() != rows() || block.cols() != cols()) throw std::runtime_error("BitMatrix dimensions do not match");
+		Metrics &stats = rowCode.metrics();
+		stats.add(Metrics::BlocksDecoded);
+
+		BitMatrix columns = block.transposed();
+		for (int i = 0; i < iterations; ++i) {
+			Pass r = correctRows(block, columns, rowDecoder);
+			Pass c = correctRows(columns, block, columnDecoder);
+			if (r.failed == 0 && c.failed == 0 && c.changed == 0) return true;
+			if (r.changed == 0 && c.changed == 0) break;
+		}
+		stats.add(Metrics::DecodeFailures);
+		return false;
+	}
+
+	template <NDLike Arr>
+	NDArray<int, int, int> encode(Arr &&message) {
+		return encode(BitMatrix::fromND(message)).toND();
+	}
+
+	/// corrects a block of an ND container in place, see decode(BitMatrix &)
+	template <NDLike Arr>
+	bool decode(Arr &&block, int iterations = 8) {
+		BitMatrix packed = BitMatrix::fromND(block);
+		bool	  res	 = decode(packed, iterations);
+		packed.toND(block);
+		return res;
+	}
+
+	template <NDLike Arr>
+	NDArray<int, int, int> message(Arr &&block) const {
+		return message(BitMatrix::fromND(block)).toND();
+	}
+};
+
+/// serial concatenation of an outer code [N, K] and an inner code [n, k] with k dividing N: the
+/// outer codeword is cut into N / k pieces of k bits and every piece is encoded by the inner
+/// code, a [N n / k, K] code. Both encodings are systematic. Decoding corrects the pieces with
+/// the inner decoder and the word of their messages with the outer one
+class ConcatenatedCode {
+	LinearCode		&outerCode;
+	LinearCode		&innerCode;
+	ComponentDecoder outerDecoder;
+	ComponentDecoder innerDecoder;
+	std::vector<int> outerInformation;
+	std::vector<int> innerInformation;
+	int				 pieces;
+
+	/// dst bits [at, at + count) = src bits [from, from + count), dst bits there start cleared
+	static void copyBits(uint64_t *dst, int at, const uint64_t *src, int from, int count) {
+		for (int j = 0; j < count; ++j)
+			if (src[(from + j) / 64] >> ((from + j) % 64) & 1) dst[(at + j) / 64] |= uint64_t(1) << ((at + j) % 64);
+	}
+
+   public:
+	/// both codes must outlive the concatenation
+	ConcatenatedCode(LinearCode &outer, LinearCode &inner)
+		: outerCode(outer), innerCode(inner), outerDecoder(outer), innerDecoder(inner),
+		  outerInformation(outer.informationPositions()), innerInformation(inner.informationPositions()) {
+		if (int(outerInformation.size()) != outer.blockLength() || int(innerInformation.size()) != inner.blockLength())
+			throw std::runtime_error("generator does not have full rank");
+		if (inner.blockLength() == 0 || outer.length() % inner.blockLength())
+			throw std::runtime_error("inner code dimension must divide the outer code length");
+		pieces = outer.length() / inner.blockLength();
+	}
+
+	int length() { return pieces * innerCode.length(); }
+	int blockLength() { return outerCode.blockLength(); }
+
+	/// codewords of the messages in the rows of messages
+	BitMatrix encode(const BitMatrix &messages) {
+		TRACE_SCOPE("ConcatenatedCode::encode");
+		int		  k = innerCode.blockLength(), n = innerCode.length();
+		BitMatrix outer = outerCode.packedEncodeSystematic(messages);
+		BitMatrix split(messages.rows() * pieces, k);
+		for (int i = 0; i < messages.rows(); ++i)
+			for (int p = 0; p < pieces; ++p)
+				copyBits(split.row(i * pieces + p), 0, outer.row(i), p * k, k);
+		BitMatrix inner = innerCode.packedEncodeSystematic(split);
+		BitMatrix res(messages.rows(), length());
+		for (int i = 0; i < messages.rows(); ++i)
+			for (int p = 0; p < pieces; ++p)
+				copyBits(res.row(i), p * n, inner.row(i * pieces + p), 0, n);
+		return res;
+	}
+
+	/// the message of one packed received word, false when the outer decoder fails. A piece the
+	/// inner decoder cannot correct is passed on as received for the outer code to fix
+	bool decode(const uint64_t *word, uint64_t *message) const {
+		int					  k = innerInformation.size(), n = innerCode.length();
+		std::vector<uint64_t> piece(BitMatrix::wordsFor(n)), pieceMessage(BitMatrix::wordsFor(k));
+		std::vector<uint64_t> outer(BitMatrix::wordsFor(pieces * k));
+		for (int p = 0; p < pieces; ++p) {
+			std::fill(piece.begin(), piece.end(), 0);
+			copyBits(piece.data(), 0, word, p * n, n);
+			innerDecoder.correct(piece.data());
+			gatherBits(piece.data(), innerInformation, pieceMessage.data());
+			copyBits(outer.data(), p * k, pieceMessage.data(), 0, k);
+		}
+		if (!outerDecoder.correct(outer.data())) return false;
+		gatherBits(outer.data(), outerInformation, message);
+		return true;
+	}
+
+	/// messages of the rows of words, decoded on the shared pool. The rows that could not be
+	/// decoded are listed in failed, in order, and their messages are left zero
+	BitMatrix decode(const BitMatrix &words, std::vector<int> &failed) {
+		TRACE_SCOPE("ConcatenatedCode::decode");
+		if (words.cols() != length()) throw std::runtime_error("BitMatrix dimensions do not match");
+		BitMatrix		  res(words.rows(), blockLength());
+		std::vector<char> ok(words.rows());
+		ThreadPool::shared().parallelFor(0, words.rows(), 16, [&](uint64_t b, uint64_t e) {
+			for (int i = b; i < int(e); ++i) {
+				ok[i] = decode(words.row(i), res.row(i));
+				if (!ok[i]) std::fill(res.row(i), res.row(i) + res.words(), 0);
+			}
+		});
+
+		Metrics &stats = outerCode.metrics();
+		stats.add(Metrics::BlocksDecoded, words.rows());
+		failed.clear();
+		for (int i = 0; i < words.rows(); ++i)
+			if (!ok[i]) failed.push_back(i);
+		stats.add(Metrics::DecodeFailures, failed.size());
+		return res;
+	}
+};
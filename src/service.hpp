@@ -0,0 +1,519 @@
+#pragma once
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bitmatrix.hpp"
+#include "code.hpp"
+#include "cyclic.hpp"
+#include "decoder.hpp"
+#include "hamming.hpp"
+#include "isd.hpp"
+#include "parallel.hpp"
+
+/// binary framing of the encode / decode service. Every message is a FrameHeader followed by
+/// length bytes of payload. Blocks are packed LSB first, bit j of a block in byte j / 8, each
+/// block padded to whole bytes. Integers are little endian
+namespace service {
+
+enum Op : uint8_t {
+	/// payload is a code name, the answer has the code id in the header and n, k as two uint32
+	Info = 1,
+	/// blocks of k bits in, blocks of n bits out
+	Encode = 2,
+	/// blocks of n bits in, blocks of k bits out
+	Decode = 3,
+};
+
+enum Status : uint8_t { Ok = 0, UnknownCode = 1, BadRequest = 2 };
+
+struct FrameHeader {
+	uint32_t length;	// payload bytes after the header
+	uint32_t id;		// echoed in the answer
+	uint16_t code;
+	uint8_t	 op;
+	uint8_t	 status;
+	uint32_t blocks;
+};
+static_assert(sizeof(FrameHeader) == 16);
+
+/// frames longer than this are refused
+constexpr uint32_t maxPayload = 64 << 20;
+
+inline int bytesFor(int bits) { return (bits + 7) / 8; }
+
+inline std::string frame(FrameHeader header, const std::string &payload) {
+	header.length = payload.size();
+	std::string res(sizeof(header), '\0');
+	std::memcpy(res.data(), &header, sizeof(header));
+	return res + payload;
+}
+
+/// rows of a BitMatrix as blocks of cols() bits
+inline std::string packBlocks(const BitMatrix &m) {
+	int			bytes = bytesFor(m.cols());
+	std::string res(std::size_t(m.rows()) * bytes, '\0');
+	for (int i = 0; i < m.rows(); ++i)
+		std::memcpy(res.data() + std::size_t(i) * bytes, m.row(i), bytes);
+	return res;
+}
+inline BitMatrix unpackBlocks(const char *data, int blocks, int bits) {
+	BitMatrix res(blocks, bits);
+	int		  bytes = bytesFor(bits);
+	for (int i = 0; i < blocks; ++i)
+		std::memcpy(res.row(i), data + std::size_t(i) * bytes, bytes);
+	res.clearPadding();
+	return res;
+}
+
+/// the decoders of one code, picked like the decode tool does: the syndrome position for
+/// Hamming codes, the Meggitt table for cyclic codes, a syndrome table while n - k fits in a
+/// word and information sets beyond that
+class ServedCode {
+	std::unique_ptr<LinearCode>		 code;
+	std::optional<HammingCode>		 hamming;
+	std::optional<CyclicCode>		 cyclic;
+	std::unique_ptr<SindromeDecoder> table;
+	std::unique_ptr<IsdDecoder>		 isd;
+
+   public:
+	explicit ServedCode(std::istream &in) : code(std::make_unique<LinearCode>(in)) {
+		hamming = HammingCode::fromLinearCode(*code);
+		if (hamming) return;
+		cyclic = CyclicCode::fromLinearCode(*code);
+		if (cyclic) return;
+		if (code->redundancy() <= 64) table = std::make_unique<SindromeDecoder>(*code, -1, WarmUp::Background);
+		else isd = std::make_unique<IsdDecoder>(*code);
+	}
+
+	LinearCode &linearCode() { return *code; }
+	int			length() { return code->length(); }
+	int			blockLength() { return code->blockLength(); }
+
+	/// message of a received word, empty when it could not be decoded
+	NDArray<int, int> decode(NDArray<int, int> &word) {
+		if (table) return table->decode(word);
+		if (isd) return isd->decode(word);
+		if (hamming && hamming->correct(word))
+			return hamming->isSystematic() ? hamming->message(word) : solve(code->generator, word);
+		if (hamming) return NDArray((_, 0), type<int>);
+		if (cyclic->correct(word)) return solve(code->generator, word);
+		return NDArray((_, 0), type<int>);
+	}
+};
+
+/// the preloaded codes, found by id or by the name they were loaded under
+class CodeService {
+	std::vector<std::unique_ptr<ServedCode>> codes;
+	std::unordered_map<std::string, int>	 names;
+
+   public:
+	/// names are the path as given and its canonical form, so clients in other directories find it
+	void load(const std::string &path) {
+		std::ifstream in(path);
+		if (!in) throw std::runtime_error("cannot open " + path);
+		codes.push_back(std::make_unique<ServedCode>(in));
+		names[path] = codes.size() - 1;
+		names[std::filesystem::weakly_canonical(path).string()] = codes.size() - 1;
+	}
+
+	int size() const { return codes.size(); }
+
+	/// the answer to one request frame
+	std::string handle(const FrameHeader &request, const char *payload) {
+		FrameHeader answer{0, request.id, request.code, request.op, Ok, 0};
+		if (request.op == Info) {
+			auto it = names.find(std::string(payload, request.length));
+			if (it == names.end()) it = names.find(std::filesystem::weakly_canonical(std::string(payload, request.length)));
+			if (it == names.end()) return frame({0, request.id, 0, Info, UnknownCode, 0}, "");
+			uint32_t shape[2] = {uint32_t(codes[it->second]->length()), uint32_t(codes[it->second]->blockLength())};
+			answer.code		  = it->second;
+			return frame(answer, std::string(reinterpret_cast<const char *>(shape), sizeof(shape)));
+		}
+		if (request.code >= codes.size()) return frame({0, request.id, request.code, request.op, UnknownCode, 0}, "");
+		ServedCode &served = *codes[request.code];
+
+		int in	= request.op == Encode ? served.blockLength() : served.length();
+		int out = request.op == Encode ? served.length() : served.blockLength();
+		if ((request.op != Encode && request.op != Decode) || uint64_t(request.blocks) * bytesFor(in) != request.length)
+			return frame({0, request.id, request.code, request.op, BadRequest, 0}, "");
+
+		BitMatrix blocks = unpackBlocks(payload, request.blocks, in);
+		answer.blocks	 = request.blocks;
+		if (request.op == Encode) return frame(answer, packBlocks(served.linearCode().packedEncode(blocks)));
+
+		// every block is one status byte and the message
+		std::string res(std::size_t(request.blocks) * (1 + bytesFor(out)), '\0');
+		NDArray<int, int> word = NDArray((_, in), type<int>);
+		for (uint32_t i = 0; i < request.blocks; ++i) {
+			for (int j = 0; j < in; ++j)
+				word[j] = int(blocks.get(i, j));
+			NDArray<int, int> message = served.decode(word);
+			char			 *dst	  = res.data() + std::size_t(i) * (1 + bytesFor(out));
+			if (message.size() == 0) {
+				dst[0] = BadRequest;
+				continue;
+			}
+			for (int j = 0; j < out; ++j)
+				if (int(message[j]) & 1) dst[1 + j / 8] |= char(1 << (j % 8));
+		}
+		return frame(answer, res);
+	}
+};
+
+/// serves a CodeService on a Unix stream socket. One thread runs an epoll loop over the
+/// connections and cuts their input into frames, a pool of workers answers them, and the
+/// answers of every connection are sent in the order of its requests, so clients can pipeline
+class ServiceServer {
+	struct Connection {
+		int							  fd = -1;
+		std::string					  in, out;
+		uint64_t					  nextRequest = 0, nextAnswer = 0;
+		std::map<uint64_t, std::string> answers;	 // done out of order, waiting for earlier ones
+		uint32_t					  events = EPOLLIN | EPOLLRDHUP;
+		bool						  closed = false;	 // the client is done sending
+	};
+	struct Completion {
+		uint64_t	connection, request;
+		std::string answer;
+	};
+
+	static constexpr uint64_t listenKey = 0, wakeKey = 1;
+
+	CodeService									&service;
+	std::string									 path;
+	int											 listenFd = -1, wakeFd = -1, epollFd = -1;
+	uint64_t									 nextKey = 2;
+	std::unordered_map<uint64_t, Connection>	 connections;
+	std::mutex									 lock;
+	std::vector<Completion>						 completions;
+	std::atomic<bool>							 stopping = false;
+	std::optional<ThreadPool>					 workers;
+
+	void watch(int fd, uint64_t key, uint32_t events, int op = EPOLL_CTL_ADD) {
+		epoll_event ev{};
+		ev.events	= events;
+		ev.data.u64 = key;
+		if (::epoll_ctl(epollFd, op, fd, &ev) < 0) throw std::runtime_error("epoll_ctl failed");
+	}
+
+	void close(uint64_t key) {
+		auto it = connections.find(key);
+		if (it == connections.end()) return;
+		::epoll_ctl(epollFd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+		::close(it->second.fd);
+		connections.erase(it);
+	}
+
+	void accept() {
+		while (true) {
+			int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if (fd < 0) return;
+			uint64_t key	 = nextKey++;
+			Connection &c	 = connections[key];
+			c.fd			 = fd;
+			watch(fd, key, c.events);
+		}
+	}
+
+	/// cuts complete frames off the input and hands them to the workers
+	void dispatch(uint64_t key, Connection &c) {
+		std::size_t used = 0;
+		while (c.in.size() - used >= sizeof(FrameHeader)) {
+			FrameHeader header;
+			std::memcpy(&header, c.in.data() + used, sizeof(header));
+			if (header.length > maxPayload) {
+				c.closed = true;
+				break;
+			}
+			if (c.in.size() - used < sizeof(header) + header.length) break;
+			std::string payload = c.in.substr(used + sizeof(header), header.length);
+			used += sizeof(header) + header.length;
+
+			uint64_t request = c.nextRequest++;
+			workers->submit([this, key, request, header, payload = std::move(payload)] {
+				std::string answer;
+				try {
+					answer = service.handle(header, payload.data());
+				} catch (const std::exception &) {
+					answer = frame({0, header.id, header.code, header.op, BadRequest, 0}, "");
+				}
+				{
+					std::lock_guard guard(lock);
+					completions.push_back({key, request, std::move(answer)});
+				}
+				uint64_t one = 1;
+				[[maybe_unused]] auto n = ::write(wakeFd, &one, sizeof(one));
+			});
+		}
+		c.in.erase(0, used);
+	}
+
+	void read(uint64_t key, Connection &c) {
+		char buffer[1 << 16];
+		while (true) {
+			ssize_t n = ::read(c.fd, buffer, sizeof(buffer));
+			if (n > 0) c.in.append(buffer, n);
+			else {
+				if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) c.closed = true;
+				break;
+			}
+		}
+		dispatch(key, c);
+	}
+
+	/// sends the answers that are next in order, closes a finished connection. false once closed
+	bool flush(uint64_t key, Connection &c) {
+		for (auto it = c.answers.begin(); it != c.answers.end() && it->first == c.nextAnswer; it = c.answers.erase(it)) {
+			c.out += it->second;
+			++c.nextAnswer;
+		}
+		while (!c.out.empty()) {
+			ssize_t n = ::send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+			if (n > 0) c.out.erase(0, n);
+			else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+			else {
+				close(key);
+				return false;
+			}
+		}
+		if (c.closed && c.out.empty() && c.nextAnswer == c.nextRequest) {
+			close(key);
+			return false;
+		}
+		// a closed input would be reported as readable over and over
+		uint32_t events = (c.closed ? 0u : EPOLLIN | EPOLLRDHUP) | (c.out.empty() ? 0u : EPOLLOUT);
+		if (events != c.events) watch(c.fd, key, events, EPOLL_CTL_MOD);
+		c.events = events;
+		return true;
+	}
+
+	void complete() {
+		uint64_t count;
+		[[maybe_unused]] auto n = ::read(wakeFd, &count, sizeof(count));
+		std::vector<Completion> done;
+		{
+			std::lock_guard guard(lock);
+			done.swap(completions);
+		}
+		for (auto &d : done) {
+			auto it = connections.find(d.connection);
+			if (it == connections.end()) continue;
+			it->second.answers.emplace(d.request, std::move(d.answer));
+		}
+		for (auto &d : done)
+			if (auto it = connections.find(d.connection); it != connections.end()) flush(d.connection, it->second);
+	}
+
+   public:
+	/// workers is the number of threads answering requests, 0 is one per core
+	ServiceServer(CodeService &service, std::string path, int workers = 0)
+		: service(service), path(std::move(path)) {
+		this->workers.emplace(workers > 0 ? workers : hardwareThreads());
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		if (this->path.size() >= sizeof(address.sun_path)) throw std::runtime_error("socket path too long");
+		std::memcpy(address.sun_path, this->path.c_str(), this->path.size() + 1);
+
+		listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		::unlink(this->path.c_str());
+		if (listenFd < 0 || ::bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+			::listen(listenFd, 128) < 0)
+			throw std::runtime_error("cannot listen on " + this->path);
+		wakeFd	= ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+		watch(listenFd, listenKey, EPOLLIN);
+		watch(wakeFd, wakeKey, EPOLLIN);
+	}
+	ServiceServer(const ServiceServer &) = delete;
+	~ServiceServer() {
+		// the workers still running write to wakeFd
+		workers.reset();
+		for (auto &[key, c] : connections)
+			::close(c.fd);
+		::close(epollFd);
+		::close(wakeFd);
+		::close(listenFd);
+		::unlink(path.c_str());
+	}
+
+	/// serves until stop is called, from any thread or a signal handler
+	void run() {
+		epoll_event events[64];
+		while (!stopping) {
+			int n = ::epoll_wait(epollFd, events, 64, -1);
+			if (n < 0 && errno != EINTR) throw std::runtime_error("epoll_wait failed");
+			for (int e = 0; e < n; ++e) {
+				uint64_t key = events[e].data.u64;
+				if (key == listenKey) accept();
+				else if (key == wakeKey) complete();
+				else if (auto it = connections.find(key); it != connections.end()) {
+					Connection &c = it->second;
+					if (events[e].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) read(key, c);
+					flush(key, c);
+				}
+			}
+		}
+	}
+	void stop() {
+		stopping		 = true;
+		uint64_t one	 = 1;
+		[[maybe_unused]] auto n = ::write(wakeFd, &one, sizeof(one));
+	}
+};
+
+/// blocking client of a ServiceServer
+class ServiceClient {
+	int		 fd;
+	uint32_t nextId = 1;
+
+	void sendAll(const std::string &bytes) {
+		for (std::size_t sent = 0; sent < bytes.size();) {
+			ssize_t n = ::send(fd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+			if (n <= 0) throw std::runtime_error("connection to the service lost");
+			sent += n;
+		}
+	}
+	void receiveAll(char *data, std::size_t size) {
+		for (std::size_t got = 0; got < size;) {
+			ssize_t n = ::read(fd, data + got, size - got);
+			if (n <= 0) throw std::runtime_error("connection to the service lost");
+			got += n;
+		}
+	}
+
+   public:
+	struct CodeInfo {
+		uint16_t code;
+		int		 n, k;
+	};
+
+	explicit ServiceClient(const std::string &path) {
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(address.sun_path)) throw std::runtime_error("socket path too long");
+		std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+		fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+			if (fd >= 0) ::close(fd);
+			throw std::runtime_error("cannot connect to " + path);
+		}
+	}
+	ServiceClient(const ServiceClient &) = delete;
+	~ServiceClient() { ::close(fd); }
+
+	/// sends one request without waiting for the answer, returns its id
+	uint32_t send(Op op, uint16_t code, uint32_t blocks, const std::string &payload) {
+		uint32_t id = nextId++;
+		sendAll(frame({0, id, code, op, Ok, blocks}, payload));
+		return id;
+	}
+	/// the next answer, they come in the order of the requests
+	std::pair<FrameHeader, std::string> receive() {
+		FrameHeader header;
+		receiveAll(reinterpret_cast<char *>(&header), sizeof(header));
+		if (header.length > maxPayload) throw std::runtime_error("answer too long");
+		std::string payload(header.length, '\0');
+		receiveAll(payload.data(), payload.size());
+		return {header, payload};
+	}
+
+	/// the id and shape of a code the service has loaded, the canonical path is asked for
+	CodeInfo info(const std::string &name) {
+		send(Info, 0, 0, std::filesystem::weakly_canonical(name).string());
+		auto [header, payload] = receive();
+		if (header.status != Ok || payload.size() != 2 * sizeof(uint32_t))
+			throw std::runtime_error("the service does not have " + name);
+		uint32_t shape[2];
+		std::memcpy(shape, payload.data(), sizeof(shape));
+		return {header.code, int(shape[0]), int(shape[1])};
+	}
+
+	/// reads '0' and '1' characters from in as blocks for op, sends them in batches with up to
+	/// window batches in flight, and calls f(input, ok, output) for every block in order. Whenever
+	/// the input is idle every outstanding answer is read, so line by line use answers each line
+	template <class F>
+	void stream(Op op, const CodeInfo &code, std::istream &in, F &&f, int batch = 64, int window = 8) {
+		int inBits	= op == Encode ? code.k : code.n;
+		int outBits = op == Encode ? code.n : code.k;
+		int status	= op == Decode;	   // decode answers carry a status byte per block
+
+		std::deque<std::vector<std::vector<int>>> inFlight;
+		auto									  answer = [&] {
+			 auto [header, payload]		   = receive();
+			 std::vector<std::vector<int>> sent = std::move(inFlight.front());
+			 inFlight.pop_front();
+			 int bytes = status + bytesFor(outBits);
+			 if (header.status != Ok || payload.size() != sent.size() * bytes)
+				 throw std::runtime_error("the service refused a request");
+			 for (std::size_t i = 0; i < sent.size(); ++i) {
+				 const char		*block = payload.data() + i * bytes;
+				 std::vector<int> out(outBits);
+				 for (int j = 0; j < outBits; ++j)
+					 out[j] = (block[status + j / 8] >> (j % 8)) & 1;
+				 f(sent[i], !status || block[0] == Ok, out);
+			 }
+		};
+
+		std::vector<std::vector<int>> blocks;
+		auto						  flush = [&] {
+			 if (blocks.empty()) return;
+			 BitMatrix packed(blocks.size(), inBits);
+			 for (std::size_t i = 0; i < blocks.size(); ++i)
+				 for (int j = 0; j < inBits; ++j)
+					 if (blocks[i][j]) packed.set(i, j);
+			 send(op, code.code, blocks.size(), packBlocks(packed));
+			 inFlight.push_back(std::move(blocks));
+			 blocks.clear();
+			 if (int(inFlight.size()) >= window) answer();
+		};
+
+		std::vector<int> block;
+		char			 c;
+		while (in.get(c)) {
+			if (c != '0' && c != '1') continue;
+			block.push_back(c - '0');
+			if (int(block.size()) < inBits) continue;
+			blocks.push_back(std::move(block));
+			block.clear();
+			// the separators after a block are usually buffered already, skip them before
+			// asking whether the input has anything more right now
+			while (in.rdbuf()->in_avail() > 0 && in.peek() != '0' && in.peek() != '1')
+				in.get();
+			// an idle input sends its partial batch and gets every answer sent so far, so
+			// interactive use never waits for later blocks or a full window
+			bool idle = in.rdbuf()->in_avail() <= 0;
+			if (int(blocks.size()) >= batch || idle) flush();
+			if (idle)
+				while (!inFlight.empty())
+					answer();
+		}
+		flush();
+		while (!inFlight.empty())
+			answer();
+	}
+};
+
+}	 // namespace service
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+/// a named POSIX shared memory segment that the first process to open it fills and every
+/// process maps read-only. Builders hold an exclusive flock on the segment while filling it,
+/// so later processes wait for a build in progress and then attach to the finished data.
+/// A segment left half built by a process that died is built again, one of another version
+/// is unlinked and made again. Segments persist after the last process unmaps them, until
+/// remove() takes the name away (decode --unshare for syndrome tables)
+class SharedSegment {
+   public:
+	static constexpr uint64_t magic	  = 0x746e656d67657321;	   // "!segment"
+	static constexpr uint32_t version = 1;
+
+	struct Header {
+		uint64_t			  magic;
+		uint32_t			  version;
+		std::atomic<uint32_t> ready;
+		uint64_t			  key;	   // what the data was built from, chosen by the user
+		uint64_t			  size;	   // bytes of data after the header
+	};
+
+   private:
+	void	   *base   = nullptr;
+	std::size_t mapped = 0;
+	bool		builder = false;
+
+	/// closes fd on every path out of the constructor
+	struct File {
+		int fd;
+		~File() {
+			if (fd >= 0) ::close(fd);
+		}
+	};
+
+   public:
+	/// maps name, building it with build(data) when it does not hold a finished segment yet.
+	/// throws when the segment was built for another key or size, which leaves it untouched
+	SharedSegment(const std::string &name, uint64_t key, std::size_t size, const std::function<void(void *)> &build) {
+		for (bool retried = false;; retried = true) {
+			File file{::shm_open(name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)};
+			if (file.fd < 0) throw std::runtime_error("cannot open shared memory " + name);
+			if (::flock(file.fd, LOCK_EX) < 0) throw std::runtime_error("cannot lock shared memory " + name);
+
+			mapped = sizeof(Header) + size;
+			struct stat info;
+			if (::fstat(file.fd, &info) < 0) throw std::runtime_error("cannot stat shared memory " + name);
+
+			if (std::size_t(info.st_size) >= sizeof(Header)) {
+				void *existing = ::mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, file.fd, 0);
+				if (existing == MAP_FAILED) throw std::runtime_error("cannot map shared memory " + name);
+				auto *header = static_cast<const Header *>(existing);
+				bool  ready	 = header->ready.load(std::memory_order_acquire);
+				bool  stale	 = ready && (header->magic != magic || header->version != version);
+				if (stale && !retried) {
+					// left by an older build, processes still using it keep their mapping
+					::munmap(existing, info.st_size);
+					remove(name);
+					continue;
+				}
+				if (ready && (stale || header->key != key || header->size != size || std::size_t(info.st_size) != mapped)) {
+					::munmap(existing, info.st_size);
+					throw std::runtime_error("shared memory " + name + " holds other data");
+				}
+				if (ready) {
+					base = existing;
+					return;
+				}
+				// a builder died before finishing, nobody can have attached to it
+				::munmap(existing, info.st_size);
+			}
+
+			if (::ftruncate(file.fd, 0) < 0 || ::ftruncate(file.fd, mapped) < 0)
+				throw std::runtime_error("cannot size shared memory " + name);
+			base = ::mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, file.fd, 0);
+			if (base == MAP_FAILED) {
+				base = nullptr;
+				throw std::runtime_error("cannot map shared memory " + name);
+			}
+			auto *header	= static_cast<Header *>(base);
+			header->magic	= magic;
+			header->version = version;
+			header->key		= key;
+			header->size	= size;
+			try {
+				build(data());
+			} catch (...) {
+				::munmap(base, mapped);
+				throw;
+			}
+			header->ready.store(1, std::memory_order_release);
+			::mprotect(base, mapped, PROT_READ);
+			builder = true;
+			return;
+		}
+	}
+	SharedSegment(const SharedSegment &) = delete;
+	~SharedSegment() {
+		if (base) ::munmap(base, mapped);
+	}
+
+	/// the data after the header, read-only once the constructor returns
+	void	   *data() const { return static_cast<char *>(base) + sizeof(Header); }
+	std::size_t size() const { return mapped - sizeof(Header); }
+	/// whether this process built the data rather than attaching to it
+	bool built() const { return builder; }
+
+	/// removes the name, processes that have it mapped keep their mapping. False when there
+	/// was no segment of that name
+	static bool remove(const std::string &name) { return ::shm_unlink(name.c_str()) == 0; }
+};
@@ -4,6 +4,7 @@
 #include <utility>
 #include <utils.hpp>
 #include "ndarray.hpp"
+#include "strided.hpp"
 
 template <class Container, class... Args>
 class Slice : public ND<Slice<Container, Args...>, Args...> {
@@ -22,23 +23,38 @@ class Slice : public ND<Slice<Container, Args...>, Args...> {
 		static_assert((std::is_integral_v<Args> && ...), "ND constructor requires integral dimensions");
 	}
 
+	/// the same block as a Strided view, only for dense underlying containers
+	auto view()
+		requires StridedViewable<Container>
+	{
+		return stridedView(*data).slice(tuple_zip(offset, cap));
+	}
+
 	auto operator[](int index)
 		requires(sizeof...(Args) > 0)
 	{
-		std::size_t i = index + get<0>(this->offset);
-		auto res = (*data)[i];
-		auto s = ::Slice(std::move(res), res.shape(), pop_front(tuple_zip(offset, cap)));
-		//std::cout << "Slice " << type_name<decltype(s)>() << " " << s.shape() << std::endl;
-		return s;
+		if constexpr (StridedViewable<Container>) {
+			return view()[index];
+		} else {
+			std::size_t i = index + get<0>(this->offset);
+			auto res = (*data)[i];
+			auto s = ::Slice(std::move(res), res.shape(), pop_front(tuple_zip(offset, cap)));
+			//std::cout << "Slice " << type_name<decltype(s)>() << " " << s.shape() << std::endl;
+			return s;
+		}
 	}
 
 	auto &operator[](Args... indices) 
 		requires(sizeof...(indices) == sizeof...(Args) && sizeof...(indices) != 1)
 	{
-		auto ind = add_v(std::forward_as_tuple(indices...), this->offset);
-		return [&]<size_t...p>(std::index_sequence<p...>) -> auto& {
-			return (*data)[(std::get<p>(ind))...];
-		}(std::make_index_sequence<sizeof...(Args)>());
+		if constexpr (StridedViewable<Container>) {
+			return view().at(indices...);
+		} else {
+			auto ind = add_v(std::forward_as_tuple(indices...), this->offset);
+			return [&]<size_t...p>(std::index_sequence<p...>) -> auto& {
+				return (*data)[(std::get<p>(ind))...];
+			}(std::make_index_sequence<sizeof...(Args)>());
+		}
 	}
 
 	operator Elem&() {
@@ -86,3 +102,8 @@ class Slice : public ND<Slice<Container, Args...>, Args...> {
 template <class U, class... Args, class ...Constraints>
 Slice(U &&, std::tuple<Args...>, std::tuple<Constraints...>) -> Slice<U, Args...>;
 
+template <class C, class... Args>
+	requires StridedViewable<C>
+auto stridedView(Slice<C, Args...> &slice) {
+	return slice.view();
+}
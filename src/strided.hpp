@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+#include <nd.hpp>
+#include <ndarray.hpp>
+
+/// non-owning view of a buffer with its own stride for every dimension.
+/// transposing, slicing, reversing and broadcasting only rewrite the strides,
+/// so all of them are O(1) and never copy the elements
+template <class T, class... Args>
+class Strided : public ND<Strided<T, Args...>, Args...> {
+	using Parent = ND<Strided<T, Args...>, Args...>;
+
+	T				   *data;
+	std::tuple<Args...> strides;
+
+   public:
+	using Elem = T;
+
+	Strided(std::tuple<Args...> dim, std::tuple<Args...> strides, T *data)
+		: Parent(dim), data(data), strides(strides) {
+		static_assert((std::is_integral_v<Args> && ...), "ND constructor requires integral dimensions");
+	}
+	Strided(const Strided &other) = default;
+
+	Strided &operator=(const Strided &other) {
+		Parent::operator=(other);
+		return *this;
+	}
+	using Parent::operator=;
+
+	/// strides of a dense row-major array with the given dimensions
+	static std::tuple<Args...> rowMajor(std::tuple<Args...> dim) {
+		std::tuple<Args...>	  s;
+		constexpr std::size_t N			 = sizeof...(Args) - 1;
+		std::size_t			  multiplier = 1;
+		[&]<std::size_t... p>(std::index_sequence<p...>) {
+			((std::get<N - p>(s) = multiplier, multiplier *= std::get<N - p>(dim)), ...);
+		}(std::make_index_sequence<sizeof...(Args)>{});
+		return s;
+	}
+
+	auto operator[](int index) const
+		requires(sizeof...(Args) > 0)
+	{
+		return ::Strided(pop_front(this->dimensions), pop_front(strides), data + index * std::get<0>(strides));
+	}
+
+	T &operator[](Args... indices) const
+		requires(sizeof...(indices) == sizeof...(Args) && sizeof...(indices) != 1)
+	{
+		return at(indices...);
+	}
+
+	/// element access that also works for rank 1
+	T &at(Args... indices) const {
+		std::ptrdiff_t		index = 0;
+		std::tuple<Args...> ind	  = std::tuple<Args...>(indices...);
+		[&]<std::size_t... p>(std::index_sequence<p...>) {
+			((index += std::ptrdiff_t(std::get<p>(ind)) * std::get<p>(strides)), ...);
+		}(std::make_index_sequence<sizeof...(Args)>{});
+		return data[index];
+	}
+
+	operator T &() const
+		requires(sizeof...(Args) == 0)
+	{
+		return *data;
+	}
+
+	std::tuple<Args...> stride() const { return strides; }
+
+	/// true when the view covers a dense row-major block, the stride of a
+	/// dimension of extent 1 is never used and does not matter
+	bool isContiguous() const
+		requires(sizeof...(Args) > 0)
+	{
+		auto dense = rowMajor(this->dimensions);
+		return [&]<std::size_t... p>(std::index_sequence<p...>) {
+			return ((std::get<p>(this->dimensions) == 1 || std::get<p>(strides) == std::get<p>(dense)) && ...);
+		}(std::make_index_sequence<sizeof...(Args)>{});
+	}
+	T *denseData() const
+		requires(sizeof...(Args) > 0)
+	{
+		return isContiguous() ? data : nullptr;
+	}
+	/// true when the last dimension can be walked with a unit stride
+	bool isInnerContiguous() const
+		requires(sizeof...(Args) > 0)
+	{
+		return std::get<sizeof...(Args) - 1>(strides) == 1;
+	}
+
+	auto transpose() const
+		requires(sizeof...(Args) == 2)
+	{
+		return ::Strided(std::make_tuple(std::get<1>(this->dimensions), std::get<0>(this->dimensions)),
+						 std::make_tuple(std::get<1>(strides), std::get<0>(strides)), data);
+	}
+
+	/// flips the order of dimension D
+	template <std::size_t D>
+	auto reverse() const {
+		auto s			= strides;
+		std::get<D>(s) = -std::get<D>(s);
+		return ::Strided(this->dimensions, s, data + (std::get<D>(this->dimensions) - 1) * std::get<D>(strides));
+	}
+
+	/// sub-block [begin, end) in every dimension, same constraint format as Slice
+	template <class... P>
+	auto slice(std::tuple<P...> c) const {
+		static_assert(sizeof...(P) == sizeof...(Args), "one range per dimension needed");
+		std::tuple<Args...> dim;
+		std::ptrdiff_t		offset = 0;
+		[&]<std::size_t... p>(std::index_sequence<p...>) {
+			((std::get<p>(dim) = std::get<p>(c).second - std::get<p>(c).first,
+			  offset += std::ptrdiff_t(std::get<p>(c).first) * std::get<p>(strides)),
+			 ...);
+		}(std::make_index_sequence<sizeof...(Args)>{});
+		return ::Strided(dim, strides, data + offset);
+	}
+
+	/// repeats the whole view n times along a new leading dimension
+	auto broadcast(int n) const { return ::Strided((n, this->dimensions), (0, strides), data); }
+
+	auto &print(std::ostream &out, int space = 2) {
+		out << "Strided" << this->dimensions << std::endl;
+		this->printInt(out, space);
+		out << std::endl;
+		return *this;
+	}
+};
+
+template <class T, class... Args>
+Strided(std::tuple<Args...>, std::tuple<Args...>, T *) -> Strided<T, Args...>;
+
+template <class T, class... Args>
+auto stridedView(NDArray<T, Args...> &array) {
+	return Strided(array.shape(), Strided<T, Args...>::rowMajor(array.shape()), &array.getLinear(0));
+}
+template <class T, class... Args>
+auto stridedView(const Strided<T, Args...> &view) {
+	return view;
+}
+
+/// containers that can be looked at through a Strided view
+template <class C>
+concept StridedViewable = requires(std::remove_reference_t<C> &c) { stridedView(c); };
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// trace of the scopes marked with TRACE_SCOPE, written as Chrome / Perfetto trace event
+/// JSON to the file named by the CODE_TRACE environment variable when the process exits.
+/// With CODE_TRACE_COUNTERS=1 every scope also records the cycles, instructions, cache misses
+/// and branch misses of its thread from perf_event_open. Scopes are only compiled in with
+/// CODE_TRACING defined, otherwise TRACE_SCOPE expands to nothing
+class Tracer {
+   public:
+	static constexpr int counters = 4;
+	static constexpr std::array<const char *, counters> counterNames = {"cycles", "instructions", "cache_misses",
+																		  "branch_misses"};
+
+	struct Event {
+		const char							 *name;
+		uint64_t							  start, duration;	  // nanoseconds since the tracer started
+		std::array<uint64_t, counters> counter;
+	};
+
+	/// events and hardware counters of one thread, kept after the thread exits
+	struct Thread {
+		int				   tid;
+		int				   perf = -1;	 // group leader, -1 without counters
+		std::mutex		   lock;
+		std::vector<Event> events;
+
+		/// the current values of the counters, zeros without them
+		std::array<uint64_t, counters> read() const {
+			std::array<uint64_t, counters> res{};
+			if (perf < 0) return res;
+			uint64_t values[1 + counters];
+			if (::read(perf, values, sizeof(values)) == sizeof(values))
+				for (int i = 0; i < counters; ++i)
+					res[i] = values[1 + i];
+			return res;
+		}
+	};
+
+   private:
+	std::string							 path;
+	bool								 sampleCounters = false;
+	std::chrono::steady_clock::time_point origin		 = std::chrono::steady_clock::now();
+	std::mutex							 lock;
+	std::vector<std::unique_ptr<Thread>> threads;
+	std::atomic<bool>					 warned = false;
+
+	/// one group of the four counters of the calling thread, -1 when the kernel refuses any of them
+	int openCounters() {
+		const uint64_t configs[counters] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+											PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+		std::vector<int> fds;
+		for (uint64_t config : configs) {
+			perf_event_attr attr{};
+			attr.type			= PERF_TYPE_HARDWARE;
+			attr.size			= sizeof(attr);
+			attr.config			= config;
+			attr.read_format	= PERF_FORMAT_GROUP;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv		= 1;
+			int fd = syscall(SYS_perf_event_open, &attr, 0, -1, fds.empty() ? -1 : fds[0], 0);
+			if (fd < 0) {
+				for (int open : fds)
+					::close(open);
+				if (!warned.exchange(true)) std::cerr << "trace: hardware counters are not available" << std::endl;
+				return -1;
+			}
+			fds.push_back(fd);
+		}
+		return fds[0];
+	}
+
+	void write() {
+		std::ofstream out(path);
+		out << "{\"traceEvents\": [";
+		bool first = true;
+		for (auto &thread : threads) {
+			std::lock_guard guard(thread->lock);
+			for (const Event &e : thread->events) {
+				char times[64];
+				std::snprintf(times, sizeof(times), "\"ts\": %.3f, \"dur\": %.3f", e.start * 1e-3, e.duration * 1e-3);
+				out << (first ? "\n" : ",\n") << "{\"name\": \"" << e.name << "\", \"ph\": \"X\", " << times
+					<< ", \"pid\": " << ::getpid() << ", \"tid\": " << thread->tid;
+				if (thread->perf >= 0) {
+					out << ", \"args\": {";
+					for (int i = 0; i < counters; ++i)
+						out << (i ? ", " : "") << '"' << counterNames[i] << "\": " << e.counter[i];
+					out << '}';
+				}
+				out << '}';
+				first = false;
+			}
+		}
+		out << "\n]}\n";
+	}
+
+   public:
+	Tracer() {
+		if (const char *target = std::getenv("CODE_TRACE")) path = target;
+		if (const char *sample = std::getenv("CODE_TRACE_COUNTERS")) sampleCounters = std::string(sample) == "1";
+	}
+	Tracer(const Tracer &) = delete;
+	~Tracer() {
+		if (enabled()) write();
+		for (auto &thread : threads)
+			if (thread->perf >= 0) ::close(thread->perf);
+	}
+
+	static Tracer &instance() {
+		static Tracer tracer;
+		return tracer;
+	}
+
+	bool enabled() const { return !path.empty(); }
+
+	uint64_t now() const {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+	}
+
+	/// the calling thread's record, opening its counters the first time
+	Thread &thread() {
+		thread_local Thread *mine = nullptr;
+		if (mine) return *mine;
+		auto created  = std::make_unique<Thread>();
+		created->tid  = int(syscall(SYS_gettid));
+		created->perf = sampleCounters ? openCounters() : -1;
+		std::lock_guard guard(lock);
+		mine = threads.emplace_back(std::move(created)).get();
+		return *mine;
+	}
+};
+
+/// records the time and counters from construction to destruction as one complete event
+class TraceScope {
+	Tracer::Thread				  *thread = nullptr;
+	const char					  *name;
+	uint64_t					   start;
+	std::array<uint64_t, Tracer::counters> counter;
+
+   public:
+	/// name must outlive the tracer, a string literal
+	explicit TraceScope(const char *name) : name(name) {
+		Tracer &tracer = Tracer::instance();
+		if (!tracer.enabled()) return;
+		thread	= &tracer.thread();
+		counter = thread->read();
+		start	= tracer.now();
+	}
+	TraceScope(const TraceScope &) = delete;
+	~TraceScope() {
+		if (!thread) return;
+		uint64_t end = Tracer::instance().now();
+		auto	 now = thread->read();
+		for (int i = 0; i < Tracer::counters; ++i)
+			counter[i] = now[i] - counter[i];
+		std::lock_guard guard(thread->lock);
+		thread->events.push_back({name, start, end - start, counter});
+	}
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#ifdef CODE_TRACING
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#endif
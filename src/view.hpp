@@ -0,0 +1,223 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+
+#include <ndarray.hpp>
+#include <strided.hpp>
+
+/// one row of elements: a pointer and a length, trivially copyable and contiguous
+template <class T>
+using RowSpan = std::span<T>;
+
+/// strides of a dense row-major block with the given extents, usable in constant expressions
+template <std::size_t R>
+constexpr std::array<std::ptrdiff_t, R> rowMajorStrides(const std::array<int, R> &extents) {
+	std::array<std::ptrdiff_t, R> res{};
+	std::ptrdiff_t				  multiplier = 1;
+	for (std::size_t d = R; d-- > 0;) {
+		res[d] = multiplier;
+		multiplier *= extents[d];
+	}
+	return res;
+}
+
+/// non-owning rank R view of elements whose last dimension is contiguous. It is a pointer, the
+/// extents and the strides, so it is trivially copyable and costs nothing to pass by value,
+/// unlike NDArray::operator[] which builds a new array per call. Indexing the first dimension
+/// gives a View of rank R - 1, a RowSpan for rank 2 and an element for rank 1. Iterators are
+/// random access, over raw pointers in the last dimension, so views work with the standard
+/// algorithms and std::ranges and the compiler sees plain loops over rows
+template <class T, std::size_t R>
+class View {
+	static_assert(R > 0, "views need at least one dimension");
+
+	T							 *first = nullptr;
+	std::array<int, R>			  dims{};
+	std::array<std::ptrdiff_t, R> steps{};
+
+	template <class A>
+	static constexpr auto tail(const A &a) {
+		std::array<typename A::value_type, R - 1> res{};
+		for (std::size_t d = 1; d < R; ++d)
+			res[d - 1] = a[d];
+		return res;
+	}
+
+   public:
+	using element_type = T;
+	static constexpr std::size_t rank = R;
+
+	/// a view of rank R - 1 one index into this one
+	using Sub = std::conditional_t<R == 1, T &, std::conditional_t<R == 2, RowSpan<T>, View<T, R - 1>>>;
+
+	constexpr View() = default;
+	/// a dense row-major block
+	constexpr View(T *data, std::array<int, R> extents) : View(data, extents, rowMajorStrides(extents)) {}
+	/// strides in elements, the last one must be 1
+	constexpr View(T *data, std::array<int, R> extents, std::array<std::ptrdiff_t, R> strides)
+		: first(data), dims(extents), steps(strides) {
+		assert(strides[R - 1] == 1);
+	}
+
+	constexpr T							   *data() const { return first; }
+	constexpr int							extent(std::size_t d) const { return dims[d]; }
+	constexpr std::ptrdiff_t				stride(std::size_t d) const { return steps[d]; }
+	constexpr const std::array<int, R>	   &extents() const { return dims; }
+	constexpr const std::array<std::ptrdiff_t, R> &strides() const { return steps; }
+
+	/// the extent of the first dimension, as for any range
+	constexpr std::size_t size() const { return dims[0]; }
+	constexpr bool		  empty() const { return dims[0] == 0; }
+	/// the number of elements in all dimensions
+	constexpr std::size_t elements() const {
+		std::size_t res = 1;
+		for (int d : dims)
+			res *= d;
+		return res;
+	}
+	/// true when the elements fill one dense row-major block
+	constexpr bool isContiguous() const {
+		auto dense = rowMajorStrides(dims);
+		for (std::size_t d = 0; d < R; ++d)
+			if (dims[d] != 1 && steps[d] != dense[d]) return false;
+		return true;
+	}
+
+	constexpr Sub operator[](int i) const {
+		if constexpr (R == 1) return first[i];
+		else if constexpr (R == 2) return RowSpan<T>(first + i * steps[0], dims[1]);
+		else return View<T, R - 1>(first + i * steps[0], tail(dims), tail(steps));
+	}
+	/// the elements of a rank 1 view
+	constexpr RowSpan<T> span() const
+		requires(R == 1)
+	{
+		return RowSpan<T>(first, dims[0]);
+	}
+	/// element access with one index per dimension
+	template <class... I>
+		requires(sizeof...(I) == R)
+	constexpr T &at(I... indices) const {
+		std::array<std::ptrdiff_t, R> index{std::ptrdiff_t(indices)...};
+		std::ptrdiff_t				  offset = 0;
+		for (std::size_t d = 0; d < R; ++d)
+			offset += index[d] * steps[d];
+		return first[offset];
+	}
+
+	/// the rows [begin, end) of the first dimension
+	constexpr View slice(int begin, int end) const {
+		auto extents = dims;
+		extents[0]	 = end - begin;
+		return View(first + begin * steps[0], extents, steps);
+	}
+
+	/// random access iterator over the first dimension of a view of rank 2 or more, it holds a
+	/// copy of the view and yields its sub-views by value
+	class Iterator {
+		View		   view;
+		std::ptrdiff_t index = 0;
+
+	   public:
+		using iterator_concept	= std::random_access_iterator_tag;
+		using iterator_category = std::input_iterator_tag;
+		using value_type		= Sub;
+		using difference_type	= std::ptrdiff_t;
+		using reference			= Sub;
+
+		constexpr Iterator() = default;
+		constexpr Iterator(View view, std::ptrdiff_t index) : view(view), index(index) {}
+
+		constexpr Sub operator*() const { return view[index]; }
+		constexpr Sub operator[](difference_type n) const { return view[index + n]; }
+
+		constexpr Iterator &operator++() {
+			++index;
+			return *this;
+		}
+		constexpr Iterator &operator--() {
+			--index;
+			return *this;
+		}
+		constexpr Iterator operator++(int) {
+			auto tmp = *this;
+			++index;
+			return tmp;
+		}
+		constexpr Iterator operator--(int) {
+			auto tmp = *this;
+			--index;
+			return tmp;
+		}
+		constexpr Iterator &operator+=(difference_type n) {
+			index += n;
+			return *this;
+		}
+		constexpr Iterator &operator-=(difference_type n) {
+			index -= n;
+			return *this;
+		}
+		friend constexpr Iterator operator+(Iterator it, difference_type n) { return it += n; }
+		friend constexpr Iterator operator+(difference_type n, Iterator it) { return it += n; }
+		friend constexpr Iterator operator-(Iterator it, difference_type n) { return it -= n; }
+		friend constexpr difference_type operator-(const Iterator &a, const Iterator &b) { return a.index - b.index; }
+
+		friend constexpr bool operator==(const Iterator &a, const Iterator &b) { return a.index == b.index; }
+		friend constexpr auto operator<=>(const Iterator &a, const Iterator &b) { return a.index <=> b.index; }
+	};
+
+	/// raw pointers for rank 1, Iterator otherwise
+	constexpr auto begin() const {
+		if constexpr (R == 1) return first;
+		else return Iterator(*this, 0);
+	}
+	constexpr auto end() const {
+		if constexpr (R == 1) return first + dims[0];
+		else return Iterator(*this, dims[0]);
+	}
+};
+
+template <class T, std::size_t R>
+inline constexpr bool std::ranges::enable_borrowed_range<View<T, R>> = true;
+template <class T, std::size_t R>
+inline constexpr bool std::ranges::enable_view<View<T, R>> = true;
+
+/// the whole array, which is always dense
+template <class T, class... Args>
+View<T, sizeof...(Args)> viewOf(NDArray<T, Args...> &array) {
+	std::array<int, sizeof...(Args)> extents = std::apply([](auto... d) { return std::array<int, sizeof...(Args)>{int(d)...}; }, array.shape());
+	return View<T, sizeof...(Args)>(array.size() ? &array.getLinear(0) : nullptr, extents);
+}
+
+/// a strided view whose last dimension has unit stride, anything else throws
+template <class T, class... Args>
+View<T, sizeof...(Args)> viewOf(const Strided<T, Args...> &view) {
+	constexpr std::size_t R = sizeof...(Args);
+	if (!view.isInnerContiguous()) throw std::runtime_error("View needs a unit stride in the last dimension");
+	std::array<int, R>			  extents = std::apply([](auto... d) { return std::array<int, R>{int(d)...}; }, view.shape());
+	std::array<std::ptrdiff_t, R> strides =
+		std::apply([](auto... s) { return std::array<std::ptrdiff_t, R>{std::ptrdiff_t(s)...}; }, view.stride());
+	return View<T, R>(view.size() ? &view.at(Args(0)...) : nullptr, extents, strides);
+}
+
+/// whether viewOf accepts the container as it is now, a strided one only with a unit inner stride
+template <class M>
+bool hasView(M &m) {
+	if constexpr (!requires { viewOf(m); }) return false;
+	else if constexpr (requires { m.isInnerContiguous(); }) return m.isInnerContiguous();
+	else return true;
+}
+
+static_assert(std::is_trivially_copyable_v<View<int, 3>> && std::is_trivially_copyable_v<RowSpan<int>>);
+static_assert(std::ranges::contiguous_range<View<int, 1>> && std::ranges::contiguous_range<RowSpan<int>>);
+static_assert(std::ranges::random_access_range<View<int, 2>> && std::ranges::random_access_range<View<int, 3>>);
+static_assert(rowMajorStrides(std::array<int, 3>{2, 3, 4}) == std::array<std::ptrdiff_t, 3>{12, 4, 1});
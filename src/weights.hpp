@@ -0,0 +1,83 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "bigint.hpp"
+#include "bitmatrix.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+
+/// number of words of every weight 0..n in the span of the rows of basis, which must be
+/// independent. The words are visited in Gray code order, one row XOR each, and the
+/// index range is split into equal power of two chunks for the threads
+inline std::vector<uint64_t> enumerateWeights(const BitMatrix &basis) {
+	TRACE_SCOPE("enumerateWeights");
+	int d = basis.rows(), n = basis.cols(), words = basis.words();
+	if (d > 48) throw std::runtime_error("too many codewords to enumerate");
+
+	int		 chunkBits = d >= 16 ? std::min(d, int(std::bit_width(unsigned(hardwareThreads()) * 4))) : 0;
+	int		 chunks	   = 1 << chunkBits;
+	uint64_t size	   = uint64_t(1) << (d - chunkBits);
+
+	std::vector<std::vector<uint64_t>> partial(chunks);
+	parallelFor(0, chunks, 1, [&](int b, int e) {
+		std::vector<uint64_t> word(words);
+		auto				  weight = [&] {
+			 int res = 0;
+			 for (int w = 0; w < words; ++w)
+				 res += std::popcount(word[w]);
+			 return res;
+		};
+		for (int c = b; c < e; ++c) {
+			std::vector<uint64_t> &hist = partial[c];
+			hist.assign(n + 1, 0);
+
+			uint64_t begin = c * size;
+			std::fill(word.begin(), word.end(), 0);
+			for (uint64_t gray = begin ^ (begin >> 1); gray; gray &= gray - 1) {
+				const uint64_t *row = basis.row(std::countr_zero(gray));
+				for (int w = 0; w < words; ++w)
+					word[w] ^= row[w];
+			}
+			++hist[weight()];
+			for (uint64_t i = begin + 1; i < begin + size; ++i) {
+				const uint64_t *row = basis.row(std::countr_zero(i));
+				for (int w = 0; w < words; ++w)
+					word[w] ^= row[w];
+				++hist[weight()];
+			}
+		}
+	});
+
+	std::vector<uint64_t> res(n + 1, 0);
+	for (auto &hist : partial)
+		for (int i = 0; i <= n; ++i)
+			res[i] += hist[i];
+	return res;
+}
+
+/// weight distribution of a binary code of length n from the distribution B of its
+/// dual of dimension dualDim: A_j = 2^-dualDim sum_i B_i K_j(i), with the Krawtchouk
+/// polynomials from (j + 1) K_{j+1}(i) = (n - 2i) K_j(i) - (n - j + 1) K_{j-1}(i)
+inline std::vector<BigInt> macWilliams(const std::vector<BigInt> &B, int dualDim) {
+	int					n = B.size() - 1;
+	std::vector<BigInt> A(n + 1);
+	std::vector<BigInt> K(n + 1);
+	for (int i = 0; i <= n; ++i) {
+		if (B[i].isZero()) continue;
+		K[0] = 1;
+		if (n > 0) K[1] = n - 2 * i;
+		for (int j = 1; j < n; ++j) {
+			K[j + 1] = K[j] * BigInt(n - 2 * i) - K[j - 1] * BigInt(n - j + 1);
+			K[j + 1].divideExact(j + 1);
+		}
+		for (int j = 0; j <= n; ++j)
+			A[j] += K[j] * B[i];
+	}
+	for (auto &a : A)
+		a >>= dualDim;
+	return A;
+}